@@ -0,0 +1,68 @@
+/*
+  LCD Library - Backend Benchmark
+
+ Prints the same text to a parallel, an I2C and a 74HC595 (SPI) display
+ and a LCDRemote and reports the time and the instrumentation counters of
+ each backend to the Serial port. For the LCDRemote we also report the
+ number of packets which were written to the output.
+
+ This example code is in the public domain.
+*/
+
+#define LCD_STATS 1
+#include <LCD.h>
+#include <LCD_SPI.h>
+
+LCD lcd(12, 11, 5, 4, 3, 2);
+LCD_I2C lcd_i2c(0x27);
+LCD_SPI lcd_spi(SPI, 10);
+
+// Output which just counts the bytes
+class CountingPrint : public Print {
+ public:
+  size_t write(uint8_t) override {
+    bytes++;
+    return 1;
+  }
+  size_t bytes = 0;
+} remote_out;
+LCDRemote lcd_remote(remote_out);
+
+void benchmark(const char *name, CommonLCD &display) {
+  display.stats().reset();
+  uint32_t start = micros();
+  for (int j = 0; j < 10; j++) {
+    display.setCursor(0, 0);
+    display.print("0123456789ABCDEF");
+  }
+  uint32_t us = micros() - start;
+
+  Serial.print(name);
+  Serial.print(": ");
+  Serial.print(us / 160);
+  Serial.println(" us per character");
+  Serial.println(display.stats());
+}
+
+void setup() {
+  Serial.begin(115200);
+  Wire.begin();
+  SPI.begin();
+
+  lcd.begin(16, 2);
+  lcd_i2c.begin(16, 2);
+  lcd_spi.begin(16, 2);
+  lcd_remote.begin(16, 2);
+
+  benchmark("LCD", lcd);
+  benchmark("LCD_I2C", lcd_i2c);
+  benchmark("LCD_SPI", lcd_spi);
+
+  uint32_t packets = lcd_remote.packets();
+  benchmark("LCDRemote", lcd_remote);
+  Serial.print("LCDRemote: ");
+  Serial.print((lcd_remote.packets() - packets) / 160.0);
+  Serial.println(" packets per character");
+}
+
+void loop() {}
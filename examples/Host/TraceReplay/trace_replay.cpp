@@ -0,0 +1,98 @@
+/*
+  LCD Library - Host Trace Replay
+
+ Command line tool which replays a trace file that was captured with the
+ Trace example into a LCDControllerModel. It prints the final screen, the
+ number of records and bus bytes and the modeled and recorded time, and
+ with an expected text file it reports the cells which differ.
+
+ Build it on the desktop against an Arduino API emulation, e.g.
+   g++ -std=c++11 -I<arduino-api>/include -I../../../src trace_replay.cpp
+ Usage:
+   trace_replay trace.bin [expected.txt [cols rows]]
+
+ This example code is in the public domain.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "LCD.h"
+
+/// Stream which reads from a file
+class FileStream : public Stream {
+ public:
+  FileStream(FILE *file) { p_file = file; }
+  int available() override { return peek() < 0 ? 0 : 1; }
+  int read() override { return fgetc(p_file); }
+  int peek() override {
+    int c = fgetc(p_file);
+    if (c >= 0) ungetc(c, p_file);
+    return c;
+  }
+  size_t write(uint8_t c) override { return 0; }
+
+ protected:
+  FILE *p_file;
+};
+
+/// Output to stdout
+class StdoutPrint : public Print {
+ public:
+  size_t write(uint8_t c) override { return fputc(c, stdout) < 0 ? 0 : 1; }
+};
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s trace.bin [expected.txt [cols rows]]\n",
+            argv[0]);
+    return 2;
+  }
+  const char *expected_file = argc > 2 ? argv[2] : nullptr;
+  int cols = argc > 4 ? atoi(argv[3]) : 16;
+  int rows = argc > 4 ? atoi(argv[4]) : 2;
+
+  FILE *trace = fopen(argv[1], "rb");
+  if (trace == nullptr) {
+    perror(argv[1]);
+    return 2;
+  }
+  LCDControllerModel model(cols, rows);
+  LCDTraceReplay replay(model);
+  FileStream in(trace);
+  size_t records = replay.replay(in);
+  fclose(trace);
+
+  StdoutPrint out;
+  out.print(model);
+  printf("records: %u\n", (unsigned)records);
+  printf("bus bytes: %u\n", (unsigned)replay.bytes());
+  printf("modeled us: %u\n", (unsigned)replay.modeledTimeUs());
+  printf("recorded us: %u\n", (unsigned)replay.recordedTimeUs());
+  if (expected_file == nullptr) return 0;
+
+  // compare the final screen with the expected text (one line per row)
+  FILE *expected = fopen(expected_file, "r");
+  if (expected == nullptr) {
+    perror(expected_file);
+    return 2;
+  }
+  int differences = 0;
+  char line[82];
+  for (int row = 0; row < rows; row++) {
+    if (fgets(line, sizeof(line), expected) == nullptr) line[0] = 0;
+    int len = strcspn(line, "\r\n");
+    for (int col = 0; col < cols; col++) {
+      char want = col < len ? line[col] : ' ';
+      char is = model.charAt(col, row);
+      if (is == want) continue;
+      differences++;
+      printf("difference at %d,%d: expected '%c' got '%c'\n", col, row, want,
+             is);
+    }
+  }
+  fclose(expected);
+  printf("differences: %d\n", differences);
+  return differences == 0 ? 0 : 1;
+}
@@ -0,0 +1,46 @@
+/*
+  LCD Library - Verify
+
+ Demonstrates the read back of the display content: the display is
+ emulated with a LCDControllerModel, so that this sketch can also be
+ executed on Linux. We change some characters behind the back of the
+ library (like an ESD hit would do) and tick() repaints the cells which
+ differ from the shadow.
+
+ With a real display replace the LCDEmulatorDriver with the defaultDriver
+ and connect the LCD R/W pin to digital pin 10.
+
+ This example code is in the public domain.
+*/
+
+#include <LCD.h>
+
+const int rs = 12, rw = 10, en = 11, d4 = 5, d5 = 4, d6 = 3, d7 = 2;
+const uint16_t data_pins[] = {d4, d5, d6, d7};
+
+LCDControllerModel model(16, 2);
+LCDEmulatorDriver emulator(model);
+LCD lcd(rs, rw, en, d4, d5, d6, d7, 0, emulator);
+
+void setup() {
+  Serial.begin(115200);
+  emulator.setPins(rs, rw, en, data_pins, 4);
+  lcd.begin(16, 2);
+  // compare 4 cells per tick
+  lcd.setVerify(4);
+  lcd.print("hello, world!");
+
+  // simulate a corruption of the display content
+  model.setDDRAM(0x01, '#');
+  model.setDDRAM(0x07, '#');
+  Serial.print(model);
+}
+
+void loop() {
+  lcd.tick();
+  if (lcd.verifyErrors() == 2) {
+    Serial.println("repaired:");
+    Serial.print(model);
+    while (true) delay(1000);
+  }
+}
@@ -0,0 +1,43 @@
+/*
+  LCD Library - Display Group
+
+ Four 20x4 I2C displays on the same Wire bus. The output is only written
+ into memory and the group sends the changed characters of all displays
+ round robin, using at most 5 ms of bus time per loop.
+
+ This example code is in the public domain.
+*/
+
+// include the library code:
+#include <LCD.h>
+
+LCD_I2C lcd0(0x24);
+LCD_I2C lcd1(0x25);
+LCD_I2C lcd2(0x26);
+LCD_I2C lcd3(0x27);
+LCDDisplayGroup group;
+
+void setup() {
+  Wire.begin();
+  lcd0.begin(20, 4);
+  lcd1.begin(20, 4);
+  lcd2.begin(20, 4);
+  lcd3.begin(20, 4);
+
+  group.add(lcd0);
+  group.add(lcd1);
+  group.add(lcd2);
+  group.add(lcd3);
+}
+
+void loop() {
+  for (int j = 0; j < group.size(); j++) {
+    group[j].setCursor(0, 0);
+    group[j].print("Display ");
+    group[j].print(j);
+    group[j].setCursor(0, 1);
+    group[j].print(millis() / 1000);
+  }
+  // send the changes within 5 ms
+  group.update(5000);
+}
@@ -0,0 +1,31 @@
+/*
+  LCD Library - Trace
+
+ Records all I2C expander output of a LCD_I2C display as binary
+ LCDTraceRecord entries to the Serial port. The captured trace can
+ be replayed offline with LCDTraceReplay into a LCDControllerModel
+ to get the final screen, the number of bus bytes and the modeled time.
+
+ This example code is in the public domain.
+*/
+
+// include the library code:
+#include <LCD.h>
+
+LCD_I2C lcd(0x27);
+LCDTraceDriver trace(Serial);
+
+void setup() {
+  Serial.begin(115200);
+  Wire.begin();
+  // record everything which is sent to the display
+  lcd.setTrace(trace);
+  lcd.begin(16, 2);
+  lcd.print("hello, world!");
+}
+
+void loop() {
+  lcd.setCursor(0, 1);
+  lcd.print(millis() / 1000);
+  delay(1000);
+}
@@ -0,0 +1,69 @@
+/*
+  LCD Library - TraceReplay
+
+ Replays a trace which was captured with the Trace example into a
+ LCDControllerModel and reports the cells which differ from the expected
+ screen. Send the binary trace to the Serial port (e.g. with a terminal
+ program which can send files): when no more data arrives the result,
+ the number of bus bytes and the modeled time are printed.
+
+ This example code is in the public domain.
+*/
+
+// include the library code:
+#include <LCD.h>
+
+const uint8_t cols = 16;
+const uint8_t rows = 2;
+// screen which is expected at the end of the trace
+const char *expected[rows] = {"hello, world!", ""};
+
+LCDControllerModel model(cols, rows);
+
+void setup() {
+  Serial.begin(115200);
+  // the end of the trace is detected by the timeout
+  Serial.setTimeout(2000);
+}
+
+void loop() {
+  if (Serial.available() == 0) return;
+
+  // each trace starts with the power on state
+  model.reset();
+  LCDTraceReplay replay(model);
+  replay.setI2CClock(100000);
+  size_t records = replay.replay(Serial);
+  Serial.println();
+  Serial.print("records: ");
+  Serial.println(records);
+  Serial.print("bus bytes: ");
+  Serial.println(replay.bytes());
+  Serial.print("modeled us: ");
+  Serial.println(replay.modeledTimeUs());
+  Serial.print("recorded us: ");
+  Serial.println(replay.recordedTimeUs());
+
+  // compare the final screen with the expected text
+  int differences = 0;
+  for (uint8_t row = 0; row < rows; row++) {
+    size_t len = strlen(expected[row]);
+    for (uint8_t col = 0; col < cols; col++) {
+      char want = col < len ? expected[row][col] : ' ';
+      char is = model.charAt(col, row);
+      if (is == want) continue;
+      differences++;
+      Serial.print("difference at ");
+      Serial.print(col);
+      Serial.print(",");
+      Serial.print(row);
+      Serial.print(": expected '");
+      Serial.print(want);
+      Serial.print("' got '");
+      Serial.print(is);
+      Serial.println("'");
+    }
+  }
+  Serial.print("differences: ");
+  Serial.println(differences);
+}
@@ -0,0 +1,71 @@
+/*
+  LCD Library - SPI Mock Check
+
+ Runs a LCD_SPIT with the LCDSPIMock instead of a 74HC595 and checks the
+ register values which are latched for a setCursor() and a character
+ against the expected sequence: for each nibble the data with EN high
+ followed by the data with EN low (Q0 = RS, Q2 = EN, Q3 = backlight).
+ A second check prints a text, starts a frame which overwrites it with
+ blanks and verifies that the text is gone after commitFrame().
+ The results are reported to the Serial port, so no hardware is needed.
+
+ This example code is in the public domain.
+*/
+
+// include the library code:
+#include <LCD.h>
+#include <LCD_SPI.h>
+
+LCDControllerModel model(16, 2);
+LCDSPIMock spi(model);
+LCD_SPIT<LCDSPIMock> lcd(spi, 10);
+
+// setCursor(1, 1) = command 0xC1, then 'A' = data 0x41
+const uint8_t expected[] = {0xCC, 0xC8, 0x1C, 0x18,
+                            0x4D, 0x49, 0x1D, 0x19};
+
+bool checkSequence() {
+  spi.reset();
+  lcd.setCursor(1, 1);
+  lcd.write('A');
+
+  bool ok = spi.bytes() == sizeof(expected);
+  for (size_t j = 0; j < sizeof(expected); j++) {
+    uint8_t value = spi.value(j);
+    Serial.print(value, HEX);
+    Serial.print(value == expected[j] ? " " : "! ");
+    if (value != expected[j]) ok = false;
+  }
+  Serial.println();
+  if (model.charAt(1, 1) != 'A') ok = false;
+  return ok;
+}
+
+bool checkFrame() {
+  lcd.setCursor(0, 0);
+  lcd.print("Hello");
+  lcd.beginFrame();
+  lcd.setCursor(0, 0);
+  lcd.print("     ");
+  lcd.commitFrame();
+
+  bool ok = true;
+  for (uint8_t col = 0; col < 5; col++) {
+    Serial.print((char)model.charAt(col, 0));
+    if (model.charAt(col, 0) != ' ') ok = false;
+  }
+  Serial.println("|");
+  return ok;
+}
+
+void setup() {
+  Serial.begin(115200);
+  lcd.begin(16, 2);
+
+  Serial.print("sequence: ");
+  Serial.println(checkSequence() ? "OK" : "FAILED");
+  Serial.print("frame: ");
+  Serial.println(checkFrame() ? "OK" : "FAILED");
+}
+
+void loop() {}
@@ -0,0 +1,27 @@
+/**
+ * @file MultiDisplayClient.ino
+ * @brief Sends the output for two displays over a single serial line to
+ * the MultiDisplayServer
+ */
+
+// include the library code:
+#include <LCD.h>
+
+LCDRemote lcd1(Serial, 1);
+LCDRemote lcd2(Serial, 2);
+
+void setup() {
+  Serial.begin(115200);
+  lcd1.begin(16, 2);
+  lcd2.begin(20, 4);
+  lcd1.print("display 1");
+  lcd2.print("display 2");
+}
+
+void loop() {
+  lcd1.setCursor(0, 1);
+  lcd1.print(millis() / 1000);
+  lcd2.setCursor(0, 3);
+  lcd2.print(millis());
+  delay(1000);
+}
@@ -0,0 +1,24 @@
+/**
+ * @file MultiDisplayServer.ino
+ * @brief Drives a parallel and an I2C display with the commands which are
+ * sent by MultiDisplayClient over a single serial line
+ */
+
+// include the library code:
+#include <LCD.h>
+
+LCD lcd(12, 11, 5, 4, 3, 2);
+LCD_I2C lcd_i2c(0x27);
+LCDClient client(Serial);
+
+void setup() {
+  Serial.begin(115200);
+  Wire.begin();
+  // the ids must match the ids used by the LCDRemote objects
+  client.addDisplay(1, lcd);
+  client.addDisplay(2, lcd_i2c);
+}
+
+void loop() {
+  client.process();
+}
@@ -2,6 +2,7 @@
 
 #include <Wire.h>
 #include <inttypes.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -13,7 +14,21 @@
  * @brief Supported (remote) Commands which are sent over the wire
  *
  */
-enum CmdEnum : uint8_t { UNDEFINED = 0, MODE, WRITE, DELAY, PULSE, BRIGHTNESS };
+enum CmdEnum : uint8_t {
+  UNDEFINED = 0,
+  MODE,
+  WRITE,
+  DELAY,
+  PULSE,
+  BRIGHTNESS,  // p1 = pin (LCD_REMOTE_PIN from a LCDRemote), p2 = percent
+  EXPANDER,  // I2C expander output: p1 = address, p2 = byte
+  SEND,      // command (p2 = LOW) or data (p2 = HIGH) byte in p1
+  BEGIN      // initialization: p1 = columns, p2 = rows
+};
+
+/// Pin of the BRIGHTNESS commands from a LCDRemote: the brightness is set on
+/// the registered display instead of a pin
+#define LCD_REMOTE_PIN 0xFFFF
 
 /**
  * @brief Command structure which is sent over the wire
@@ -21,26 +36,478 @@ enum CmdEnum : uint8_t { UNDEFINED = 0, MODE, WRITE, DELAY, PULSE, BRIGHTNESS };
  */
 struct __attribute__((__packed__)) Cmd {
   Cmd() = default;
-  Cmd(CmdEnum id, uint16_t p1, uint16_t p2 = 0) {
-    this->id = id;
+  Cmd(CmdEnum id, uint16_t p1, uint16_t p2 = 0, uint8_t display = 0) {
+    this->id = (CmdEnum)(id | (display << 4));
     this->p1 = p1;
     this->p2 = p2;
   }
+  /// Command without the display id
+  CmdEnum command() const { return (CmdEnum)(id & 0x0F); }
+  /// Display id (0-15) which is sent in the upper 4 bits of the id
+  uint8_t display() const { return id >> 4; }
+
   CmdEnum id = UNDEFINED;
   uint16_t p1 = 0;
   uint16_t p2 = 0;
 };
 
+// Instrumentation is opt-in: #define LCD_STATS 1 before including LCD.h
+#ifndef LCD_STATS
+#define LCD_STATS 0
+#endif
+
+#if LCD_STATS
+
+/**
+ * @brief Public calls for which we record a latency histogram
+ */
+enum LCDStatsOp : uint8_t {
+  LCD_OP_PRINT = 0,
+  LCD_OP_CLEAR,
+  LCD_OP_SET_CURSOR,
+  LCD_OP_CREATE_CHAR,
+  LCD_OP_COUNT
+};
+
+/**
+ * @brief Counters and log2 latency histograms which are collected by
+ * CommonLCD when LCD_STATS is active. Bucket n counts the calls which took
+ * less then 2^(n+1) us (the last bucket collects everything slower).
+ */
+struct LCDStats : public Printable {
+  static const int BUCKETS = 16;
+
+  uint32_t commands = 0;
+  uint32_t data = 0;
+  uint32_t i2c_transactions = 0;
+  uint32_t gpio_writes = 0;
+  uint32_t delay_us = 0;
+  uint32_t spi_bytes = 0;
+  uint16_t histogram[LCD_OP_COUNT][BUCKETS] = {};
+
+  /// Sets all counters to 0
+  void reset() { *this = LCDStats(); }
+
+  /// Adds a measured latency to the histogram of the indicated call
+  void record(LCDStatsOp op, uint32_t us) {
+    int bucket = 0;
+    while (us > 1 && bucket < BUCKETS - 1) {
+      us >>= 1;
+      bucket++;
+    }
+    if (histogram[op][bucket] < 0xFFFF) {
+      histogram[op][bucket]++;
+    }
+  }
+
+  /// Dumps the counters and all non empty histogram buckets
+  size_t printTo(Print &p) const override {
+    static const char *names[LCD_OP_COUNT] = {"print", "clear", "setCursor",
+                                              "createChar"};
+    size_t result = 0;
+    result += p.print("commands: ");
+    result += p.println(commands);
+    result += p.print("data: ");
+    result += p.println(data);
+    result += p.print("i2c: ");
+    result += p.println(i2c_transactions);
+    result += p.print("gpio: ");
+    result += p.println(gpio_writes);
+    result += p.print("spi: ");
+    result += p.println(spi_bytes);
+    result += p.print("delay_us: ");
+    result += p.println(delay_us);
+    for (int op = 0; op < LCD_OP_COUNT; op++) {
+      result += p.print(names[op]);
+      result += p.print(":");
+      for (int j = 0; j < BUCKETS; j++) {
+        if (histogram[op][j] > 0) {
+          result += p.print(" <");
+          result += p.print(2ul << j);
+          result += p.print("us=");
+          result += p.print(histogram[op][j]);
+        }
+      }
+      result += p.println();
+    }
+    return result;
+  }
+};
+
+/**
+ * @brief Measures the time until the end of the scope
+ */
+class LCDStatsTimer {
+ public:
+  LCDStatsTimer(LCDStats &stats, LCDStatsOp op) {
+    p_stats = &stats;
+    this->op = op;
+    start = micros();
+  }
+  ~LCDStatsTimer() { p_stats->record(op, micros() - start); }
+
+ protected:
+  LCDStats *p_stats;
+  LCDStatsOp op;
+  uint32_t start;
+};
+
+#define LCD_STATS_ADD(field, n) _stats.field += (n)
+#define LCD_STATS_TIME(op) LCDStatsTimer stats_timer(_stats, op)
+
+#else
+
+#define LCD_STATS_ADD(field, n)
+#define LCD_STATS_TIME(op)
+
+#endif
+
+// Compile time defaults for the timing (in us unless indicated otherwise)
+#ifndef LCD_TIMING_ENABLE_PULSE_US
+#define LCD_TIMING_ENABLE_PULSE_US 1
+#endif
+#ifndef LCD_TIMING_COMMAND_US
+#define LCD_TIMING_COMMAND_US 50
+#endif
+#ifndef LCD_TIMING_CLEAR_US
+#define LCD_TIMING_CLEAR_US 2000
+#endif
+#ifndef LCD_TIMING_POWER_ON_US
+#define LCD_TIMING_POWER_ON_US 50000
+#endif
+#ifndef LCD_TIMING_INIT_US
+#define LCD_TIMING_INIT_US 4500
+#endif
+#ifndef LCD_TIMING_INIT_SHORT_US
+#define LCD_TIMING_INIT_SHORT_US 150
+#endif
+#ifndef LCD_TIMING_RESET_MS
+#define LCD_TIMING_RESET_MS 1000
+#endif
+
+/**
+ * @brief Timing profile of a controller: the default values are taken from
+ * the LCD_TIMING_ defines. Use setTiming() to change them.
+ */
+struct LCDTiming {
+  /// Enable high time (I2C backend: GPIO drivers always use 1 us)
+  uint16_t enable_pulse_us = LCD_TIMING_ENABLE_PULSE_US;
+  /// Time after each command or data byte
+  uint16_t command_us = LCD_TIMING_COMMAND_US;
+  /// Execution time of clear() and home()
+  uint16_t clear_us = LCD_TIMING_CLEAR_US;
+  /// Wait after power on before the first command (may exceed the 16383 us
+  /// of delayMicroseconds(): it is executed in steps)
+  uint16_t power_on_us = LCD_TIMING_POWER_ON_US;
+  /// Wait after the first function set commands of the initialization
+  uint16_t init_us = LCD_TIMING_INIT_US;
+  /// Wait after the last function set command of the initialization
+  uint16_t init_short_us = LCD_TIMING_INIT_SHORT_US;
+  /// Wait in ms after the reset of the I2C expander
+  uint16_t reset_ms = LCD_TIMING_RESET_MS;
+
+  /// Hitachi HD44780 (270 kHz): 37 us / 1.52 ms with a safety margin
+  static LCDTiming HD44780() {
+    LCDTiming result;
+    result.enable_pulse_us = 1;
+    result.command_us = 50;
+    result.clear_us = 2000;
+    result.power_on_us = 50000;
+    result.init_us = 4500;
+    result.init_short_us = 150;
+    result.reset_ms = 1000;
+    return result;
+  }
+
+  /// Sitronix ST7066U and SPLC780 compatible controllers
+  static LCDTiming ST7066U() {
+    LCDTiming result;
+    result.enable_pulse_us = 1;
+    result.command_us = 40;
+    result.clear_us = 1600;
+    result.power_on_us = 40000;
+    result.init_us = 4100;
+    result.init_short_us = 100;
+    result.reset_ms = 50;
+    return result;
+  }
+
+  /// Slow controllers e.g. OLED displays with a HD44780 compatible interface
+  static LCDTiming Slow() {
+    LCDTiming result;
+    result.enable_pulse_us = 2;
+    result.command_us = 100;
+    result.clear_us = 6200;
+    result.power_on_us = 65000;
+    result.init_us = 5000;
+    result.init_short_us = 500;
+    result.reset_ms = 1000;
+    return result;
+  }
+};
+
+#ifndef PROGMEM
+#define PROGMEM
+#endif
+#ifndef pgm_read_byte
+#define pgm_read_byte(addr) (*(const uint8_t *)(addr))
+#endif
+#ifndef pgm_read_word
+#define pgm_read_word(addr) (*(const uint16_t *)(addr))
+#endif
+
+/// PWM value (20-225) for the brightness in percent: the values follow a
+/// gamma 2.2 curve so that the steps look linear to the eye
+const uint8_t lcd_gamma_table[101] PROGMEM = {
+     20,  20,  20,  20,  20,  20,  20,  21,  21,  21,  21,  22,
+     22,  22,  23,  23,  24,  24,  25,  25,  26,  27,  27,  28,
+     29,  30,  31,  32,  32,  33,  35,  36,  37,  38,  39,  40,
+     42,  43,  44,  46,  47,  49,  50,  52,  54,  55,  57,  59,
+     61,  63,  65,  67,  69,  71,  73,  75,  77,  80,  82,  84,
+     87,  89,  92,  94,  97,  99, 102, 105, 108, 111, 114, 116,
+    120, 123, 126, 129, 132, 135, 139, 142, 145, 149, 152, 156,
+    160, 163, 167, 171, 175, 179, 183, 187, 191, 195, 199, 203,
+    207, 212, 216, 221, 225};
+
+/// Converts the brightness in percent (0-100) to the PWM value
+inline uint8_t lcdBrightnessToPWM(uint16_t percent) {
+  return pgm_read_byte(&lcd_gamma_table[percent > 100 ? 100 : percent]);
+}
+
+/// Character ROM of the controller which is used to map UTF-8 characters
+enum LCDRomCode : uint8_t {
+  LCD_ROM_RAW = 0,  // no UTF-8 decoding: bytes are sent unchanged
+  LCD_ROM_A00,      // Japanese standard font
+  LCD_ROM_A02       // European font (Latin-1 at 0xA0-0xFF)
+};
+
+// CGRAM slots for glyphs which are not in the ROM: they are shared with
+// LCDBarGraph (0-4), LCDBigNumber (5-7), LCDCanvas and LCDAnimation
+#ifndef LCD_GLYPH_FIRST_SLOT
+#define LCD_GLYPH_FIRST_SLOT 0
+#endif
+#ifndef LCD_GLYPH_SLOTS
+#define LCD_GLYPH_SLOTS 8
+#endif
+
+/// Unicode code point and the corresponding character in the ROM
+struct LCDRomMapping {
+  uint16_t code_point;
+  uint8_t rom;
+};
+
+/// Characters of the A00 ROM outside of ASCII (sorted by code point)
+const LCDRomMapping lcd_rom_a00[] PROGMEM = {
+    {0x00A5, 0x5C},  // ¥
+    {0x00B0, 0xDF},  // °
+    {0x00B5, 0xE4},  // µ
+    {0x00B7, 0xA5},  // ·
+    {0x00DF, 0xE2},  // ß
+    {0x00E4, 0xE1},  // ä
+    {0x00F1, 0xEE},  // ñ
+    {0x00F6, 0xEF},  // ö
+    {0x00F7, 0xFD},  // ÷
+    {0x00FC, 0xF5},  // ü
+    {0x03A3, 0xF6},  // Σ
+    {0x03A9, 0xF4},  // Ω
+    {0x03B1, 0xE0},  // α
+    {0x03B2, 0xE2},  // β
+    {0x03B5, 0xE3},  // ε
+    {0x03B8, 0xF2},  // θ
+    {0x03C0, 0xF7},  // π
+    {0x03C3, 0xE5},  // σ
+    {0x2190, 0x7F},  // ←
+    {0x2192, 0x7E},  // →
+    {0x221A, 0xE8},  // √
+    {0x221E, 0xF3},  // ∞
+    {0x2588, 0xFF},  // █
+};
+
+/// Unicode code point and the 5x8 bitmap which is used if the character is
+/// not available in the ROM
+struct LCDGlyph {
+  uint16_t code_point;
+  uint8_t bitmap[8];
+};
+
+/// Glyphs which are loaded into the CGRAM on demand (sorted by code point)
+const LCDGlyph lcd_glyphs[] PROGMEM = {
+    {0x00C4, {0x0A, 0x00, 0x0E, 0x11, 0x1F, 0x11, 0x11, 0x00}},  // Ä
+    {0x00C9, {0x02, 0x04, 0x1F, 0x10, 0x1E, 0x10, 0x1F, 0x00}},  // É
+    {0x00D6, {0x0A, 0x00, 0x0E, 0x11, 0x11, 0x11, 0x0E, 0x00}},  // Ö
+    {0x00DC, {0x0A, 0x00, 0x11, 0x11, 0x11, 0x11, 0x0E, 0x00}},  // Ü
+    {0x00E0, {0x08, 0x04, 0x0E, 0x01, 0x0F, 0x11, 0x0F, 0x00}},  // à
+    {0x00E2, {0x04, 0x0A, 0x0E, 0x01, 0x0F, 0x11, 0x0F, 0x00}},  // â
+    {0x00E7, {0x00, 0x0E, 0x10, 0x10, 0x11, 0x0E, 0x04, 0x0C}},  // ç
+    {0x00E8, {0x08, 0x04, 0x0E, 0x11, 0x1F, 0x10, 0x0E, 0x00}},  // è
+    {0x00E9, {0x02, 0x04, 0x0E, 0x11, 0x1F, 0x10, 0x0E, 0x00}},  // é
+    {0x00EA, {0x04, 0x0A, 0x0E, 0x11, 0x1F, 0x10, 0x0E, 0x00}},  // ê
+    {0x00EB, {0x0A, 0x00, 0x0E, 0x11, 0x1F, 0x10, 0x0E, 0x00}},  // ë
+    {0x00EE, {0x04, 0x0A, 0x00, 0x0C, 0x04, 0x04, 0x0E, 0x00}},  // î
+    {0x00EF, {0x0A, 0x00, 0x0C, 0x04, 0x04, 0x04, 0x0E, 0x00}},  // ï
+    {0x00F4, {0x04, 0x0A, 0x0E, 0x11, 0x11, 0x11, 0x0E, 0x00}},  // ô
+    {0x00F9, {0x08, 0x04, 0x11, 0x11, 0x11, 0x13, 0x0D, 0x00}},  // ù
+    {0x00FB, {0x04, 0x0A, 0x11, 0x11, 0x11, 0x13, 0x0D, 0x00}},  // û
+    {0x20AC, {0x06, 0x09, 0x1C, 0x08, 0x1C, 0x09, 0x06, 0x00}},  // €
+};
+
+/// Determines the ROM character for a unicode code point: -1 if not found
+inline int lcdRomChar(uint32_t code_point, LCDRomCode rom) {
+  if (code_point < 0x80) {
+    // A00 has a yen sign instead of the backslash and an arrow instead of
+    // the tilde
+    if (rom == LCD_ROM_A00 && (code_point == '\\' || code_point == '~')) {
+      return -1;
+    }
+    return code_point;
+  }
+  if (rom == LCD_ROM_A02) {
+    return code_point >= 0xA0 && code_point <= 0xFF ? (int)code_point : -1;
+  }
+  int low = 0;
+  int high = sizeof(lcd_rom_a00) / sizeof(LCDRomMapping) - 1;
+  while (low <= high) {
+    int mid = (low + high) / 2;
+    uint16_t cp = pgm_read_word(&lcd_rom_a00[mid].code_point);
+    if (cp == code_point) return pgm_read_byte(&lcd_rom_a00[mid].rom);
+    if (cp < code_point) {
+      low = mid + 1;
+    } else {
+      high = mid - 1;
+    }
+  }
+  return -1;
+}
+
+/// Determines the index in lcd_glyphs for a unicode code point: -1 if not
+/// found
+inline int lcdGlyphIndex(uint32_t code_point) {
+  int low = 0;
+  int high = sizeof(lcd_glyphs) / sizeof(LCDGlyph) - 1;
+  while (low <= high) {
+    int mid = (low + high) / 2;
+    uint16_t cp = pgm_read_word(&lcd_glyphs[mid].code_point);
+    if (cp == code_point) return mid;
+    if (cp < code_point) {
+      low = mid + 1;
+    } else {
+      high = mid - 1;
+    }
+  }
+  return -1;
+}
+
+/// Compile time sequence of indexes (std::index_sequence is C++14)
+template <size_t... I>
+struct lcd_index_sequence {
+  typedef lcd_index_sequence type;
+};
+template <class A, class B>
+struct lcd_concat_index_sequence;
+template <size_t... I, size_t... J>
+struct lcd_concat_index_sequence<lcd_index_sequence<I...>,
+                                 lcd_index_sequence<J...>>
+    : lcd_index_sequence<I..., (sizeof...(I) + J)...> {};
+/// 0 to N - 1: the halves are built separately, so that the template depth
+/// only grows with log2(N)
+template <size_t N>
+struct lcd_make_index_sequence
+    : lcd_concat_index_sequence<
+          typename lcd_make_index_sequence<N / 2>::type,
+          typename lcd_make_index_sequence<N - N / 2>::type> {};
+template <>
+struct lcd_make_index_sequence<0> : lcd_index_sequence<> {};
+template <>
+struct lcd_make_index_sequence<1> : lcd_index_sequence<0> {};
+
+/// Expander byte k (0-5) of a character for a PCF8574 backpack without the
+/// backlight bit: each nibble is set up before EN goes high and held after
+/// EN goes low, like write4bits() (RS = 1, EN = 4)
+constexpr uint8_t lcdLabelI2CByte(char c, size_t k) {
+  return (k < 3 ? ((uint8_t)c & 0xF0) : (((uint8_t)c << 4) & 0xF0)) | 0x01 |
+         (k % 3 == 1 ? 0x04 : 0x00);
+}
+
+/// Byte k (0-4) of a SEND Cmd (little endian) for display 0
+constexpr uint8_t lcdLabelPacketByte(char c, size_t k) {
+  return k == 0 ? (uint8_t)SEND : k == 1 ? (uint8_t)c : k == 3 ? HIGH : 0;
+}
+
+/// Reference to the data of a LCDLabel
+struct LCDLabelRef {
+  const char *text;
+  const uint8_t *i2c;
+  const uint8_t *packet;
+  uint8_t len;
+};
+
+/**
+ * @brief Constant text which is encoded at compile time into the wire
+ * format of LCD_I2C (expander bytes) and LCDRemote (SEND packets), so that
+ * it can be sent without any runtime encoding. Create it with lcdLabel()
+ * and store it in flash:
+ * static const auto temp PROGMEM = lcdLabel("Temp:");
+ * lcd.printLabel(temp);
+ */
+template <size_t N>
+struct LCDLabel {
+  char text[N];
+  uint8_t i2c[(N - 1) * 6];
+  uint8_t packet[(N - 1) * sizeof(Cmd)];
+
+  LCDLabelRef ref() const { return LCDLabelRef{text, i2c, packet, N - 1}; }
+};
+
+template <size_t N, size_t... T, size_t... E, size_t... P>
+constexpr LCDLabel<N> lcdMakeLabel(const char (&str)[N],
+                                   lcd_index_sequence<T...>,
+                                   lcd_index_sequence<E...>,
+                                   lcd_index_sequence<P...>) {
+  return LCDLabel<N>{{str[T]...},
+                     {lcdLabelI2CByte(str[E / 6], E % 6)...},
+                     {lcdLabelPacketByte(str[P / sizeof(Cmd)],
+                                         P % sizeof(Cmd))...}};
+}
+
+/// Encodes a string literal at compile time (see LCDLabel)
+template <size_t N>
+constexpr LCDLabel<N> lcdLabel(const char (&str)[N]) {
+  static_assert(N > 1 && N < 256, "label must have 1 to 254 characters");
+  return lcdMakeLabel(str, lcd_make_index_sequence<N>(),
+                      lcd_make_index_sequence<(N - 1) * 6>(),
+                      lcd_make_index_sequence<(N - 1) * sizeof(Cmd)>());
+}
+
 /**
  * @brief AbstractLCDDriver: commands which are serialized and sent over
  * the wire
  */
 struct AbstractLCDDriver {
-  virtual void pinModeLCD(uint16_t pin, uint16_t mode);
-  virtual void digitalWriteLCD(uint16_t pin, uint16_t value);
-  virtual void delayMicrosecondsLCD(uint16_t ms);
-  virtual void pulseEnable(uint16_t pin);
-  virtual void setBrightness(uint16_t pin, uint16_t percent);
+  virtual void pinModeLCD(uint16_t pin, uint16_t mode) = 0;
+  virtual void digitalWriteLCD(uint16_t pin, uint16_t value) = 0;
+  virtual void delayMicrosecondsLCD(uint16_t ms) = 0;
+  /// Obsolete: pulses the enable pin with the default command settle time.
+  /// Drivers which only implement this method keep working.
+  virtual void pulseEnable(uint16_t pin) {
+    digitalWriteLCD(pin, LOW);
+    delayMicrosecondsLCD(1);
+    digitalWriteLCD(pin, HIGH);
+    delayMicrosecondsLCD(1);  // enable pulse must be >450 ns
+    digitalWriteLCD(pin, LOW);
+    delayMicrosecondsLCD(LCD_TIMING_COMMAND_US);
+  }
+  /// Pulses the enable pin and waits settle_us for the command to complete
+  virtual void pulseEnable(uint16_t pin, uint16_t settle_us) {
+    pulseEnable(pin);
+    delayMicrosecondsLCD(settle_us);
+  }
+  virtual void setBrightness(uint16_t pin, uint16_t percent) = 0;
+  /// false if the output is sent to a remote device
+  virtual bool isLocal() { return true; }
+  /// Sends out any buffered commands
+  virtual void flush() {}
+  /// Reads the pin: remote drivers can not read and return LOW
+  virtual uint16_t digitalReadLCD(uint16_t pin) { return LOW; }
 };
 
 /**
@@ -55,18 +522,20 @@ struct LCDDriver : public AbstractLCDDriver {
 
   void delayMicrosecondsLCD(uint16_t ms) override { delayMicroseconds(ms); }
 
-  void pulseEnable(uint16_t pin) override {
+  uint16_t digitalReadLCD(uint16_t pin) override { return digitalRead(pin); }
+
+  using AbstractLCDDriver::pulseEnable;
+  void pulseEnable(uint16_t pin, uint16_t settle_us) override {
     digitalWrite(pin, LOW);
     delayMicroseconds(1);
     digitalWriteLCD(pin, HIGH);
     delayMicroseconds(1);  // enable pulse must be >450 ns
     digitalWrite(pin, LOW);
-    delayMicroseconds(100);  // commands need >37 us to settle
+    delayMicroseconds(settle_us);  // commands need >37 us to settle
   }
 
   void setBrightness(uint16_t pin, uint16_t percent) override {
-    int val = map(percent, 0, 100, 20, 225);
-    analogWrite(pin, val);
+    analogWrite(pin, lcdBrightnessToPWM(percent));
   }
 
 } defaultDriver;
@@ -79,78 +548,149 @@ struct LCDWriteDriver : public AbstractLCDDriver {
   LCDWriteDriver(Print &out) { p_out = &out; }
 
   void pinModeLCD(uint16_t pin, uint16_t mode) override {
-    Cmd cmd(MODE, pin, mode);
-    p_out->write((uint8_t *)&cmd, sizeof(cmd));
+    write(Cmd(MODE, pin, mode));
   }
 
   void digitalWriteLCD(uint16_t pin, uint16_t value) override {
-    Cmd cmd(WRITE, pin, value);
-    p_out->write((uint8_t *)&cmd, sizeof(cmd));
+    write(Cmd(WRITE, pin, value));
   }
 
-  void delayMicrosecondsLCD(uint16_t ms) override {
-    Cmd cmd(DELAY, ms);
-    p_out->write((uint8_t *)&cmd, sizeof(cmd));
-  }
+  void delayMicrosecondsLCD(uint16_t ms) override { write(Cmd(DELAY, ms)); }
 
-  void pulseEnable(uint16_t pin) override {
-    Cmd cmd(PULSE, pin);
-    p_out->write((uint8_t *)&cmd, sizeof(cmd));
+  using AbstractLCDDriver::pulseEnable;
+  void pulseEnable(uint16_t pin, uint16_t settle_us) override {
+    write(Cmd(PULSE, pin, settle_us));
   }
 
   void setBrightness(uint16_t pin, uint16_t percent) override {
-    Cmd cmd(BRIGHTNESS, pin, percent);
-    p_out->write((uint8_t *)&cmd, sizeof(cmd));
+    write(Cmd(BRIGHTNESS, pin, percent));
+  }
+
+  bool isLocal() override { return false; }
+
+  /// Adds any command to the buffer: the buffer is sent when it is full or
+  /// with flush()
+  void write(const Cmd &cmd) {
+    if (_len + sizeof(cmd) > len) flush();
+    memcpy(buffer + _len, &cmd, sizeof(cmd));
+    _len += sizeof(cmd);
+  }
+
+  /// Adds pre-encoded commands (e.g. from a LCDLabel in PROGMEM) for the
+  /// indicated display
+  void write(const uint8_t *cmds, int count, uint8_t display = 0) {
+    for (int j = 0; j < count; j++) {
+      if (_len + sizeof(Cmd) > len) flush();
+      for (size_t k = 0; k < sizeof(Cmd); k++) {
+        buffer[_len++] = pgm_read_byte(cmds++);
+      }
+      buffer[_len - sizeof(Cmd)] |= display << 4;
+    }
+  }
+
+  /// Sends the buffered commands with one write
+  void flush() override {
+    if (_len == 0) return;
+    p_out->write((const uint8_t *)buffer, _len);
+    _len = 0;
+    _packets++;
   }
 
+  /// Number of writes to the output
+  uint32_t packets() { return _packets; }
+
  protected:
   Print *p_out;
   static const int len = 80;
   char buffer[len];
+  int _len = 0;
+  uint32_t _packets = 0;
 };
 
 /**
- * @brief LCDClient which processes the request provided by the indicated Stream
- * in the Arduino loop call process().
+ * @brief Record of a trace: the time in us since the prior record (limited
+ * to 0xFFFF) followed by the Cmd
  */
-class LCDClient {
-  LCDClient(Stream &in) { p_in = &in; };
+struct __attribute__((__packed__)) LCDTraceRecord {
+  uint16_t delta_us = 0;
+  Cmd cmd;
+};
 
-  /// Call this method in the loop
-  void process(int delay_no_data = 100) {
-    if (p_in->available() > 0) {
-      if (p_in->readBytes((uint8_t *)&cmd, sizeof(Cmd)) > 0) {
-        switch (cmd.id) {
-          case MODE:
-            pinMode(cmd.p1, cmd.p1);
-            break;
-          case WRITE:
-            digitalWrite(cmd.p1, cmd.p1);
-            break;
-          case DELAY:
-            delayMicroseconds(cmd.p1);
-            break;
-          case PULSE:
-            defaultDriver.pulseEnable(cmd.p1);
-            break;
-          case BRIGHTNESS:
-            defaultDriver.setBrightness(cmd.p1, cmd.p2);
-            break;
-          default:
-            Serial.print("Error - undefined id");
-            break;
-        }
-      }
-    } else {
-      delay(delay_no_data);
-    }
+/**
+ * @brief Driver which records all low level operations as LCDTraceRecord
+ * to the indicated Print (e.g. a File) and optionally forwards them to
+ * another driver. The trace can be analysed later with LCDTraceReplay.
+ */
+struct LCDTraceDriver : public AbstractLCDDriver {
+  /// Records the operations only
+  LCDTraceDriver(Print &out) { p_out = &out; }
+
+  /// Records the operations and executes them with the indicated driver
+  LCDTraceDriver(Print &out, AbstractLCDDriver &driver) {
+    p_out = &out;
+    p_driver = &driver;
+  }
+
+  void pinModeLCD(uint16_t pin, uint16_t mode) override {
+    record(Cmd(MODE, pin, mode));
+    if (p_driver != nullptr) p_driver->pinModeLCD(pin, mode);
+  }
+
+  void digitalWriteLCD(uint16_t pin, uint16_t value) override {
+    record(Cmd(WRITE, pin, value));
+    if (p_driver != nullptr) p_driver->digitalWriteLCD(pin, value);
+  }
+
+  void delayMicrosecondsLCD(uint16_t ms) override {
+    record(Cmd(DELAY, ms));
+    if (p_driver != nullptr) p_driver->delayMicrosecondsLCD(ms);
+  }
+
+  using AbstractLCDDriver::pulseEnable;
+  void pulseEnable(uint16_t pin, uint16_t settle_us) override {
+    record(Cmd(PULSE, pin, settle_us));
+    if (p_driver != nullptr) p_driver->pulseEnable(pin, settle_us);
+  }
+
+  void setBrightness(uint16_t pin, uint16_t percent) override {
+    record(Cmd(BRIGHTNESS, pin, percent));
+    if (p_driver != nullptr) p_driver->setBrightness(pin, percent);
+  }
+
+  bool isLocal() override {
+    return p_driver == nullptr || p_driver->isLocal();
+  }
+
+  void flush() override {
+    if (p_driver != nullptr) p_driver->flush();
+  }
+
+  uint16_t digitalReadLCD(uint16_t pin) override {
+    return p_driver != nullptr ? p_driver->digitalReadLCD(pin) : LOW;
+  }
+
+  /// Writes a single record with the actual timestamp
+  void record(const Cmd &cmd) {
+    uint32_t now = micros();
+    LCDTraceRecord rec;
+    uint32_t delta = is_first ? 0 : now - last_us;
+    rec.delta_us = delta > 0xFFFF ? 0xFFFF : delta;
+    rec.cmd = cmd;
+    p_out->write((uint8_t *)&rec, sizeof(rec));
+    last_us = now;
+    is_first = false;
+    count++;
   }
 
+  /// Number of recorded operations
+  uint32_t records() { return count; }
+
  protected:
-  Stream *p_in = nullptr;
-  static const int len = 80;
-  Cmd cmd;
-  LCDDriver defaultDriver;
+  Print *p_out = nullptr;
+  AbstractLCDDriver *p_driver = nullptr;
+  uint32_t last_us = 0;
+  uint32_t count = 0;
+  bool is_first = true;
 };
 
 /**
@@ -158,7 +698,15 @@ class LCDClient {
  *
  */
 class CommonLCD : public Print {
+  friend class LCDClient;
+
  public:
+  ~CommonLCD() {
+    if (_shadow != nullptr) {
+      delete[] _shadow;
+    }
+  }
+
   void setRowOffsets(int row0, int row1, int row2, int row3) {
     _row_offsets[0] = row0;
     _row_offsets[1] = row1;
@@ -168,16 +716,34 @@ class CommonLCD : public Print {
 
   /********** high level commands, for the user! */
   void clear() {
-    command(LCD_CLEARDISPLAY);   // clear display, set cursor position to zero
-    delayMicrosecondsLCD(2000);  // this command takes a long time!
+    LCD_STATS_TIME(LCD_OP_CLEAR);
+    if (_deferred) {
+      // just mark the changed cells: update() sends them
+      for (int j = 0; j < LCD_DDRAM_SIZE; j++) {
+        setShadowChar(j, ' ');
+      }
+      _addr = 0;
+      _addr_cgram = false;
+      return;
+    }
+    command(LCD_CLEARDISPLAY);  // clear display, set cursor position to zero
+    delayMicrosecondsLCD(_timing.clear_us);  // this command takes a long time!
+    if (_batch == 0) flush();
   }
 
   void home() {
-    command(LCD_RETURNHOME);     // set cursor position to zero
-    delayMicrosecondsLCD(2000);  // this command takes a long time!
+    if (_deferred) {
+      // the next deferred output starts at the first cell as well
+      _addr = 0;
+      _addr_cgram = false;
+    }
+    command(LCD_RETURNHOME);  // set cursor position to zero
+    delayMicrosecondsLCD(_timing.clear_us);  // this command takes a long time!
+    if (_batch == 0) flush();
   }
 
   void setCursor(uint8_t col, uint8_t row) {
+    LCD_STATS_TIME(LCD_OP_SET_CURSOR);
     const size_t max_lines = sizeof(_row_offsets) / sizeof(*_row_offsets);
     if (row >= max_lines) {
       row = max_lines - 1;  // we count rows starting w/ 0
@@ -185,7 +751,13 @@ class CommonLCD : public Print {
     if (row >= _numlines) {
       row = _numlines - 1;  // we count rows starting w/ 0
     }
+    selectRow(row);
 
+    if (_deferred) {
+      _addr = (col + _row_offsets[row]) & 0x7F;
+      _addr_cgram = false;
+      return;
+    }
     command(LCD_SETDDRAMADDR | (col + _row_offsets[row]));
   }
 
@@ -228,6 +800,22 @@ class CommonLCD : public Print {
     command(LCD_CURSORSHIFT | LCD_DISPLAYMOVE | LCD_MOVERIGHT);
   }
 
+  // These commands move the cursor by one position
+  void moveCursorLeft(void) {
+    if (_deferred) {
+      _addr = nextAddress(_addr, false);
+      return;
+    }
+    command(LCD_CURSORSHIFT | LCD_CURSORMOVE | LCD_MOVELEFT);
+  }
+  void moveCursorRight(void) {
+    if (_deferred) {
+      _addr = nextAddress(_addr, true);
+      return;
+    }
+    command(LCD_CURSORSHIFT | LCD_CURSORMOVE | LCD_MOVERIGHT);
+  }
+
   // This is for text that flows Left to Right
   void leftToRight(void) {
     _displaymode |= LCD_ENTRYLEFT;
@@ -259,31 +847,310 @@ class CommonLCD : public Print {
   // Allows us to fill the first 8 CGRAM locations
   // with custom characters
   void createChar(uint8_t location, uint8_t charmap[]) {
+    LCD_STATS_TIME(LCD_OP_CREATE_CHAR);
     location &= 0x7;  // we only have 8 locations 0-7
+    beginBatch();
     command(LCD_SETCGRAMADDR | (location << 3));
     for (int i = 0; i < 8; i++) {
-      write(charmap[i]);
+      writeData(charmap[i]);
     }
+    endBatch();
   }
 
   /// Starts the processing by defining the number of columns and rows
   virtual void begin(uint8_t lcd_cols, uint8_t lcd_rows,
                      uint8_t charsize = LCD_5x8DOTS) = 0;
 
+  /// Prints a label which was created with lcdLabel() and stored with
+  /// PROGMEM: backends which support it send the pre-encoded data
+  template <size_t N>
+  size_t printLabel(const LCDLabel<N> &label) {
+    return writeLabel(label.ref());
+  }
+
+  /// Activates the decoding of UTF-8 for the indicated character ROM:
+  /// characters which are not in the ROM are loaded on demand into the
+  /// CGRAM slots first_slot to first_slot + slots - 1. If more glyphs are
+  /// needed, the oldest slot is replaced, which also changes the cells that
+  /// still display it. The slots must not overlap with the slots of
+  /// LCDBarGraph, LCDBigNumber, LCDCanvas or LCDAnimation which are used at
+  /// the same time (slots = 0 only uses the ROM). Multi byte sequences are
+  /// decoded in print() of strings: a single write() of a byte (e.g.
+  /// write(0xDF) for the degree sign) is sent unchanged.
+  void setRomCode(LCDRomCode rom, uint8_t first_slot = LCD_GLYPH_FIRST_SLOT,
+                  uint8_t slots = LCD_GLYPH_SLOTS) {
+    _rom_code = rom;
+    _utf8_pending = 0;
+    _utf8_lead = 0;
+    _glyph_first = first_slot & 0x7;
+    _glyph_slots = _glyph_first + slots > 8 ? 8 - _glyph_first : slots;
+    _glyph_next = 0;
+    for (int j = 0; j < 8; j++) _glyph_cp[j] = 0;
+  }
+
+  LCDRomCode romCode() { return _rom_code; }
+
   /// Output of a single char
   inline size_t write(uint8_t value) {
-    send(value, HIGH);
+    if (_rom_code != LCD_ROM_RAW && !_addr_cgram) {
+      // a lead byte without continuation is a raw character
+      if (_utf8_lead != 0 && (value & 0xC0) != 0x80) writeLead();
+      if (!decodeUTF8(value)) return 1;
+    }
+    writeCell(value);
     return 1;  // assume success
   }
 
+  /// Restricts the following output to the indicated rectangle: the text
+  /// wraps at the right border (or is clipped if wrap is false), '\n'
+  /// clears the rest of the row and continues in the next row. Output below
+  /// the last row is ignored.
+  void openRegion(uint8_t x, uint8_t y, uint8_t w, uint8_t h,
+                  bool wrap = true) {
+    _region_x = x;
+    _region_y = y;
+    _region_w = w;
+    _region_h = h;
+    _region_col = 0;
+    _region_row = 0;
+    _region_wrap = wrap;
+    _region_open = true;
+  }
+
+  /// Ends the output to the region: the remaining cells are cleared if
+  /// clear is true
+  void closeRegion(bool clear = true) {
+    if (!_region_open) return;
+    if (clear) {
+      beginBatch();
+      while (_region_row < _region_h) {
+        clearRegionRow();
+        _region_row++;
+        _region_col = 0;
+      }
+      endBatch();
+    }
+    _region_open = false;
+  }
+
+  /// Returns true between openRegion() and closeRegion()
+  bool isRegionOpen() { return _region_open; }
+
+  /// Output of multiple chars (e.g. from print): sent as one batch and
+  /// decoded as UTF-8, so this is also needed without LCD_STATS
+  size_t write(const uint8_t *buffer, size_t size) override {
+    LCD_STATS_TIME(LCD_OP_PRINT);
+    bool utf8_buffer = _utf8_buffer;
+    _utf8_buffer = true;
+    beginBatch();
+    for (size_t j = 0; j < size; j++) {
+      write(buffer[j]);
+    }
+    _utf8_buffer = utf8_buffer;
+    if (!_utf8_buffer && _utf8_lead != 0) writeLead();
+    endBatch();
+    return size;
+  }
+
+  /// Sends out any data which was buffered by the backend
+  void flush() override {}
+
   using Print::write;
 
-  /// Defines the brightness (0-100)
-  virtual void setBrightness(uint16_t percent) {
-    int val = map(percent, 0, 100, 20, 225);
-    analogWrite(_led_a, val);
+  /// Defines the brightness (0-100): stops any fading
+  void setBrightness(uint16_t percent) {
+    _fading = false;
+    _brightness = percent > 100 ? 100 : percent;
+    writeBrightness(_brightness);
+  }
+
+  /// Current brightness (0-100)
+  uint16_t brightness() { return _brightness; }
+
+  /// Changes the brightness within the indicated time: the steps are
+  /// executed by tick(). Remote displays only get the final value.
+  void fadeTo(uint16_t percent, uint32_t duration_ms) {
+    if (percent > 100) percent = 100;
+    if (duration_ms == 0 || isRemote()) {
+      setBrightness(percent);
+      return;
+    }
+    _fade_from = _brightness;
+    _fade_to = percent;
+    _fade_start_ms = millis();
+    _fade_ms = duration_ms;
+    _fading = true;
+  }
+
+  /// Returns true while a fadeTo() is in progress
+  bool isFading() { return _fading; }
+
+  /// Executes the pending time based actions (fading, verification): call
+  /// in the loop
+  void tick() {
+    if (_verify_cells > 0) verify(_verify_cells);
+    if (!_fading) return;
+    uint32_t elapsed = millis() - _fade_start_ms;
+    uint16_t percent = _fade_to;
+    if (elapsed < _fade_ms) {
+      percent = _fade_from +
+                ((int32_t)_fade_to - _fade_from) * (int32_t)elapsed /
+                    (int32_t)_fade_ms;
+    } else {
+      _fading = false;
+    }
+    // only output the changed values
+    if (percent != _brightness) {
+      _brightness = percent;
+      writeBrightness(percent);
+    }
+  }
+
+  /// Reads the character at the indicated DDRAM address: -1 if reading is
+  /// not supported
+  virtual int readDDRAM(uint8_t addr) { return -1; }
+
+  /// Reads the byte at the indicated CGRAM address: -1 if reading is not
+  /// supported
+  virtual int readCGRAM(uint8_t addr) { return -1; }
+
+  /// Activates the verification of the display content in tick(): the
+  /// indicated number of DDRAM and CGRAM cells are read back and compared
+  /// with the shadow (which is enabled by this method) and the cells which
+  /// differ are rewritten. The unknown cells of the shadow are read back
+  /// first. 0 deactivates the verification.
+  bool setVerify(uint8_t cells_per_tick) {
+    _verify_cells = cells_per_tick;
+    if (cells_per_tick == 0) return true;
+    if (!enableShadow()) return false;
+    readShadow();
+    return true;
+  }
+
+  /// Number of cells which were rewritten by the verification
+  uint32_t verifyErrors() { return _verify_errors; }
+
+  /// Keeps a copy of the DDRAM and CGRAM in memory: call after begin().
+  /// The cells which are already on the display are unknown: they are not
+  /// sent by update(), but the next write is sent even if it is a blank.
+  bool enableShadow() {
+    if (!isShadowSupported()) return false;
+    if (_shadow == nullptr) {
+      _shadow = new uint8_t[LCD_SHADOW_SIZE];
+      if (_shadow == nullptr) return false;
+      memset(_shadow, ' ', LCD_DDRAM_SIZE);
+      memset(_shadow + LCD_DDRAM_SIZE, 0, LCD_SHADOW_SIZE - LCD_DDRAM_SIZE);
+      for (int j = 0; j < LCD_DDRAM_SIZE; j++) setUnknown(j, true);
+    }
+    return true;
+  }
+
+  /// Deferred output: write(), setCursor() and clear() only change the
+  /// shadow and the changed cells are sent with update(). Deactivating it
+  /// sends all pending changes. The autoscroll entry mode is not supported.
+  bool setDeferred(bool active) {
+    if (active) {
+      if (!enableShadow()) return false;
+      _deferred = true;
+    } else if (_deferred) {
+      _deferred = false;
+      update();
+      // continue at the logical cursor position
+      command(_addr_cgram ? LCD_SETCGRAMADDR | _addr
+                          : LCD_SETDDRAMADDR | _addr);
+    }
+    return true;
+  }
+
+  bool isDeferred() { return _deferred; }
+
+  /// Sends the changed cells to the display until the indicated time (in us)
+  /// is used up (0 = no limit). Returns the number of remaining changed cells
+  size_t update(uint32_t max_us = 0) {
+    if (_shadow == nullptr) return 0;
+    uint32_t start = micros();
+    beginBatch();
+    // continue where we stopped the last time so that all cells get a chance
+    for (int n = 0; n < LCD_DDRAM_SIZE; n++) {
+      int j = (_update_pos + n) % LCD_DDRAM_SIZE;
+      if (!isDirty(j)) continue;
+      uint8_t addr = ddramAddress(j);
+      if (_hw_cgram || _hw_addr != addr) {
+        command(LCD_SETDDRAMADDR | addr);
+      }
+      writeData(_shadow[j]);
+      if (max_us > 0 && micros() - start >= max_us) {
+        _update_pos = (j + 1) % LCD_DDRAM_SIZE;
+        break;
+      }
+    }
+    endBatch();
+    return backlog();
+  }
+
+  /// Number of changed cells which still need to be sent by update()
+  size_t backlog() {
+    if (_shadow == nullptr) return 0;
+    size_t result = 0;
+    for (int j = 0; j < LCD_DDRAM_SIZE; j++) {
+      if (isDirty(j)) result++;
+    }
+    return result;
+  }
+
+  /// Starts a frame: the following output only changes the shadow until
+  /// commitFrame() is called, so that the display never shows a partially
+  /// updated screen.
+  bool beginFrame() {
+    if (!_in_frame) {
+      _frame_deferred = _deferred;
+      _in_frame = true;
+    }
+    return setDeferred(true);
+  }
+
+  /// Sends all changes of the frame in one batch. With blank the display is
+  /// switched off during the transfer. Returns the number of changed cells.
+  size_t commitFrame(bool blank = false) {
+    if (!_in_frame) return 0;
+    size_t changed = backlog();
+    bool off = blank && changed > 0 && (_displaycontrol & LCD_DISPLAYON);
+    beginBatch();
+    if (off) command(LCD_DISPLAYCONTROL | (_displaycontrol & ~LCD_DISPLAYON));
+    update();
+    if (off) command(LCD_DISPLAYCONTROL | _displaycontrol);
+    if (!_frame_deferred) setDeferred(false);
+    endBatch();
+    _in_frame = false;
+    return changed;
+  }
+
+  /// Returns true between beginFrame() and commitFrame()
+  bool isInFrame() { return _in_frame; }
+
+  /// Number of columns defined in begin()
+  uint8_t cols() { return _cols; }
+
+  /// Number of rows defined in begin()
+  uint8_t rows() { return _numlines; }
+
+  /// Character in the shadow at the indicated position (0 if not available)
+  uint8_t charAt(uint8_t col, uint8_t row) {
+    if (_shadow == nullptr || row >= 4) return 0;
+    return _shadow[ddramIndex(col + _row_offsets[row])];
   }
 
+  /// Defines the timing profile (e.g. LCDTiming::ST7066U()): call before begin
+  void setTiming(const LCDTiming &timing) { _timing = timing; }
+
+  /// Provides the actual timing profile
+  const LCDTiming &timing() { return _timing; }
+
+#if LCD_STATS
+  /// Provides the collected instrumentation data (see LCD_STATS)
+  LCDStats &stats() { return _stats; }
+#endif
+
  protected:
   // commands
   const uint8_t LCD_CLEARDISPLAY = 0x01;
@@ -323,34 +1190,619 @@ class CommonLCD : public Print {
   static const uint8_t LCD_5x10DOTS = 0x04;
   static const uint8_t LCD_5x8DOTS = 0x00;
 
+  // shadow: DDRAM (0x00-0x27, 0x40-0x67), CGRAM and one dirty and one
+  // unknown bit per cell
+  static const int LCD_DDRAM_SIZE = 80;
+  static const int LCD_CGRAM_SIZE = 64;
+  static const int LCD_SHADOW_SIZE =
+      LCD_DDRAM_SIZE + LCD_CGRAM_SIZE + 2 * (LCD_DDRAM_SIZE / 8);
+
   // variables
-  uint8_t _row_offsets[4];
-  uint8_t _displaymode;
-  uint8_t _displaycontrol;
-  uint8_t _numlines;
-  uint8_t _led_a;  // LED brightness
+  uint8_t _row_offsets[4] = {0x00, 0x40, 0x14, 0x54};
+  uint8_t _displaymode = 0;
+  uint8_t _displaycontrol = 0;
+  uint8_t _numlines = 1;
+  uint8_t _cols = 16;
+  uint8_t _led_a = 0;  // LED brightness
+  uint8_t _addr = 0;  // logical address counter
+  bool _addr_cgram = false;
+  uint8_t _hw_addr = 0;  // address counter of the display
+  bool _hw_cgram = false;
+  uint8_t *_shadow = nullptr;
+  bool _deferred = false;
+  uint16_t _brightness = 100;
+  uint16_t _fade_from = 0;
+  uint16_t _fade_to = 0;
+  uint32_t _fade_start_ms = 0;
+  uint32_t _fade_ms = 0;
+  bool _fading = false;
+  uint8_t _verify_cells = 0;
+  uint8_t _verify_pos = 0;
+  uint32_t _verify_errors = 0;
+  bool _region_open = false;
+  bool _region_wrap = true;
+  uint8_t _region_x = 0;
+  uint8_t _region_y = 0;
+  uint8_t _region_w = 0;
+  uint8_t _region_h = 0;
+  uint8_t _region_col = 0;
+  uint8_t _region_row = 0;
+  LCDRomCode _rom_code = LCD_ROM_RAW;
+  uint32_t _utf8_cp = 0;
+  uint8_t _utf8_pending = 0;
+  // lead byte of a sequence until the first continuation byte
+  uint8_t _utf8_lead = 0;
+  // true while the bytes of a string are written
+  bool _utf8_buffer = false;
+  uint8_t _glyph_first = LCD_GLYPH_FIRST_SLOT;
+  uint8_t _glyph_slots = LCD_GLYPH_SLOTS;
+  uint8_t _glyph_next = 0;
+  // code point which is loaded in the CGRAM slot (0 = none)
+  uint16_t _glyph_cp[8] = {0};
+  bool _in_frame = false;
+  bool _frame_deferred = false;
+  int _update_pos = 0;
+  LCDTiming _timing;
+#if LCD_STATS
+  LCDStats _stats;
+#endif
 
-  inline void command(uint8_t value) { send(value, LOW); }
-  virtual void delayMicrosecondsLCD(uint16_t ms)  { delayMicroseconds(ms); }
-  virtual void send(uint8_t value, uint8_t mode) = 0;
-};
+  uint8_t _batch = 0;  // nesting level of operations with multiple sends
 
-/**
- * @brief Output to LCD
- *
- */
-class LCD : public CommonLCD {
- public:
-  // When the display powers up, it is configured as follows:
-  //
-  // 1. Display clear
-  // 2. Function set:
-  //    DL = 1; 8-bit interface data
-  //    N = 0; 1-line display
-  //    F = 0; 5x8 dot character font
-  // 3. Display on/off control:
-  //    D = 0; Display off
-  //    C = 0; Cursor off
+  inline void command(uint8_t value) {
+    LCD_STATS_ADD(commands, 1);
+    send(value, LOW);
+    trackCommand(value);
+    if (_batch == 0) flush();
+  }
+
+  /// Sends a data byte to the display (DDRAM or CGRAM)
+  void writeData(uint8_t value) {
+    LCD_STATS_ADD(data, 1);
+    send(value, HIGH);
+    trackData(value);
+    if (_batch == 0) flush();
+  }
+
+  /// Updates the shadow and the address counter after a data write
+  void trackData(uint8_t value) {
+    if (_shadow != nullptr) {
+      if (_hw_cgram) {
+        _shadow[LCD_DDRAM_SIZE + (_hw_addr & 0x3F)] = value;
+      } else {
+        int idx = ddramIndex(_hw_addr);
+        _shadow[idx] = value;
+        setDirty(idx, false);
+        setUnknown(idx, false);
+      }
+    }
+    advanceAddress();
+  }
+
+  /// Output of a label: the pre-encoded data can only be used for a plain
+  /// DDRAM output
+  bool isLabelDirect() {
+    return !_deferred && !_addr_cgram && !_region_open &&
+           _rom_code == LCD_ROM_RAW;
+  }
+
+  /// Output of a label character by character
+  virtual size_t writeLabel(const LCDLabelRef &label) {
+    LCD_STATS_TIME(LCD_OP_PRINT);
+    beginBatch();
+    for (int j = 0; j < label.len; j++) {
+      write((uint8_t)pgm_read_byte(label.text + j));
+    }
+    endBatch();
+    return label.len;
+  }
+
+  /// The address counter moves after each data read or write
+  void advanceAddress() {
+    _hw_addr = _hw_cgram ? (_hw_addr + ((_displaymode & LCD_ENTRYLEFT) ? 1 : -1)) & 0x3F
+                         : nextAddress(_hw_addr, _displaymode & LCD_ENTRYLEFT);
+    if (!_deferred) {
+      _addr = _hw_addr;
+      _addr_cgram = _hw_cgram;
+    }
+  }
+
+  /// Compares the indicated number of cells with the shadow and rewrites
+  /// the cells which differ
+  void verify(int cells) {
+    if (_shadow == nullptr) return;
+    uint8_t addr = _addr;
+    bool addr_cgram = _addr_cgram;
+    bool repainted = false;
+    beginBatch();
+    for (int k = 0; k < cells; k++) {
+      int j = _verify_pos;
+      _verify_pos = (_verify_pos + 1) % (LCD_DDRAM_SIZE + LCD_CGRAM_SIZE);
+      if (j < LCD_DDRAM_SIZE) {
+        // changes which were not sent yet are handled by update() and
+        // unknown cells can not be compared
+        if (isDirty(j) || isUnknown(j)) continue;
+        int value = readDDRAM(ddramAddress(j));
+        if (value < 0) break;
+        if (value == _shadow[j]) continue;
+        command(LCD_SETDDRAMADDR | ddramAddress(j));
+        writeData(_shadow[j]);
+      } else {
+        int cg = j - LCD_DDRAM_SIZE;
+        int value = readCGRAM(cg);
+        if (value < 0) break;
+        // only 5 bits are used
+        if (((value ^ _shadow[j]) & 0x1F) == 0) continue;
+        command(LCD_SETCGRAMADDR | cg);
+        writeData(_shadow[j]);
+      }
+      _verify_errors++;
+      repainted = true;
+    }
+    if (repainted && !_deferred) {
+      command(addr_cgram ? LCD_SETCGRAMADDR | addr : LCD_SETDDRAMADDR | addr);
+    }
+    endBatch();
+  }
+
+  /// Keeps track of the address counter of the display
+  void trackCommand(uint8_t value) {
+    if (value & LCD_SETDDRAMADDR) {
+      _hw_addr = value & 0x7F;
+      _hw_cgram = false;
+    } else if (value & LCD_SETCGRAMADDR) {
+      _hw_addr = value & 0x3F;
+      _hw_cgram = true;
+    } else if (value & LCD_FUNCTIONSET) {
+      // no impact on the address
+    } else if (value & LCD_CURSORSHIFT) {
+      if (!(value & LCD_DISPLAYMOVE)) {
+        _hw_addr = nextAddress(_hw_addr, value & LCD_MOVERIGHT);
+      }
+    } else if (value & (LCD_DISPLAYCONTROL | LCD_ENTRYMODESET)) {
+      // no impact on the address
+    } else if (value & LCD_RETURNHOME) {
+      _hw_addr = 0;
+      _hw_cgram = false;
+    } else if (value == LCD_CLEARDISPLAY) {
+      _hw_addr = 0;
+      _hw_cgram = false;
+      if (_shadow != nullptr) {
+        for (int j = 0; j < LCD_DDRAM_SIZE; j++) {
+          _shadow[j] = ' ';
+          setDirty(j, false);
+          setUnknown(j, false);
+        }
+      }
+    }
+    if (!_deferred) {
+      _addr = _hw_addr;
+      _addr_cgram = _hw_cgram;
+    }
+  }
+
+  /// Maps the DDRAM addresses 0x00-0x27 and 0x40-0x67 to 0-79
+  static int ddramIndex(uint8_t addr) {
+    addr &= 0x7F;
+    return addr >= 0x40 ? 40 + (addr - 0x40) % 40 : addr % 40;
+  }
+
+  static uint8_t ddramAddress(int idx) {
+    return idx >= 40 ? 0x40 + idx - 40 : idx;
+  }
+
+  /// DDRAM address after a write: line 1 continues in line 2 and vice versa
+  static uint8_t nextAddress(uint8_t addr, bool increment) {
+    int idx = ddramIndex(addr) + (increment ? 1 : -1);
+    if (idx < 0) idx = LCD_DDRAM_SIZE - 1;
+    if (idx >= LCD_DDRAM_SIZE) idx = 0;
+    return ddramAddress(idx);
+  }
+
+  bool isDirty(int idx) {
+    return _shadow[LCD_DDRAM_SIZE + LCD_CGRAM_SIZE + idx / 8] & (1 << (idx % 8));
+  }
+
+  void setDirty(int idx, bool dirty) {
+    uint8_t &bits = _shadow[LCD_DDRAM_SIZE + LCD_CGRAM_SIZE + idx / 8];
+    bits = dirty ? bits | (1 << (idx % 8)) : bits & ~(1 << (idx % 8));
+  }
+
+  /// A cell is unknown if it was not written since the shadow was enabled
+  bool isUnknown(int idx) {
+    return _shadow[LCD_DDRAM_SIZE + LCD_CGRAM_SIZE + LCD_DDRAM_SIZE / 8 +
+                   idx / 8] &
+           (1 << (idx % 8));
+  }
+
+  void setUnknown(int idx, bool unknown) {
+    uint8_t &bits = _shadow[LCD_DDRAM_SIZE + LCD_CGRAM_SIZE +
+                            LCD_DDRAM_SIZE / 8 + idx / 8];
+    bits = unknown ? bits | (1 << (idx % 8)) : bits & ~(1 << (idx % 8));
+  }
+
+  /// Fills the unknown cells and the CGRAM of the shadow with the content
+  /// of the display (if it can be read)
+  void readShadow() {
+    for (int j = 0; j < LCD_DDRAM_SIZE; j++) {
+      if (!isUnknown(j)) continue;
+      int value = readDDRAM(ddramAddress(j));
+      if (value < 0) return;
+      _shadow[j] = value;
+      setUnknown(j, false);
+    }
+    for (int j = 0; j < LCD_CGRAM_SIZE; j++) {
+      int value = readCGRAM(j);
+      if (value < 0) return;
+      _shadow[LCD_DDRAM_SIZE + j] = value;
+    }
+  }
+
+  /// Changes a cell of the shadow and marks it as dirty if it was changed
+  /// (or if the content of the display is unknown)
+  void setShadowChar(int idx, uint8_t value) {
+    if (_shadow[idx] != value || isUnknown(idx)) {
+      _shadow[idx] = value;
+      setDirty(idx, true);
+    }
+  }
+
+  /// Rewrites the display and entry mode registers, the CGRAM and the
+  /// DDRAM from the shadow (e.g. after a communication error). The DDRAM is
+  /// cleared and only the cells which are not blank are written. A display
+  /// shift is not restored.
+  void restore() {
+    if (_shadow == nullptr) return;
+    uint8_t addr = _addr;
+    bool addr_cgram = _addr_cgram;
+    uint8_t displaymode = _displaymode;
+    beginBatch();
+    command(LCD_DISPLAYCONTROL | _displaycontrol);
+    _displaymode = LCD_ENTRYLEFT;
+    command(LCD_ENTRYMODESET | _displaymode);
+    // CGRAM: only the slots which are used
+    for (int slot = 0; slot < 8; slot++) {
+      const uint8_t *glyph = _shadow + LCD_DDRAM_SIZE + slot * 8;
+      bool used = false;
+      for (int j = 0; j < 8; j++) used = used || glyph[j] != 0;
+      if (!used) continue;
+      command(LCD_SETCGRAMADDR | (slot << 3));
+      for (int j = 0; j < 8; j++) writeData(glyph[j]);
+    }
+    // clear without resetting the shadow
+    send(LCD_CLEARDISPLAY, LOW);
+    delayMicrosecondsLCD(_timing.clear_us);
+    _hw_addr = 0;
+    _hw_cgram = false;
+    for (int j = 0; j < LCD_DDRAM_SIZE; j++) {
+      setDirty(j, false);
+      setUnknown(j, false);
+      if (_shadow[j] == ' ') continue;
+      uint8_t cell = ddramAddress(j);
+      if (_hw_cgram || _hw_addr != cell) command(LCD_SETDDRAMADDR | cell);
+      writeData(_shadow[j]);
+    }
+    _displaymode = displaymode;
+    command(LCD_ENTRYMODESET | _displaymode);
+    command(addr_cgram ? LCD_SETCGRAMADDR | addr : LCD_SETDDRAMADDR | addr);
+    endBatch();
+  }
+
+  /// Backends may buffer all sends until the end of the batch
+  void beginBatch() { _batch++; }
+  void endBatch() {
+    if (_batch > 0 && --_batch == 0) flush();
+  }
+  virtual void delayMicrosecondsLCD(uint16_t ms) {
+    LCD_STATS_ADD(delay_us, ms);
+    delayMicroseconds(ms);
+  }
+  /// Waits longer than delayMicroseconds() supports on AVR (16383 us, e.g.
+  /// the power on time): the delay is split into shorter steps
+  void delayLongLCD(uint32_t us) {
+    while (us > 10000) {
+      delayMicrosecondsLCD(10000);
+      us -= 10000;
+    }
+    delayMicrosecondsLCD(us);
+  }
+  virtual void send(uint8_t value, uint8_t mode) = 0;
+  /// Outputs the brightness (0-100) via PWM
+  virtual void writeBrightness(uint16_t percent) {
+    if (_led_a != 0) {
+      analogWrite(_led_a, lcdBrightnessToPWM(percent));
+    }
+  }
+  /// true if the output is sent to a remote device
+  virtual bool isRemote() { return false; }
+  /// Called by setCursor() before the address is set: displays with
+  /// multiple controllers select the controller of the row
+  virtual void selectRow(uint8_t row) {}
+  /// false if the DDRAM addresses are not unique (e.g. multiple controllers)
+  virtual bool isShadowSupported() { return true; }
+
+  /// Output of a single char at the current address
+  void writeChar(uint8_t value) {
+    if (_deferred && !_addr_cgram) {
+      setShadowChar(ddramIndex(_addr), value);
+      _addr = nextAddress(_addr, _displaymode & LCD_ENTRYLEFT);
+      return;
+    }
+    writeData(value);
+  }
+
+  /// Output of a char into the open region: the address is only set at the
+  /// start of each row
+  void writeRegion(uint8_t value) {
+    if (value == '\r') return;
+    if (value == '\n') {
+      clearRegionRow();
+      _region_row++;
+      _region_col = 0;
+      return;
+    }
+    if (_region_col >= _region_w) {
+      if (!_region_wrap) return;
+      _region_row++;
+      _region_col = 0;
+    }
+    if (_region_row >= _region_h) return;
+    if (_region_col == 0) setCursor(_region_x, _region_y + _region_row);
+    writeChar(value);
+    _region_col++;
+  }
+
+  /// Clears the remaining cells of the current region row
+  void clearRegionRow() {
+    if (_region_row >= _region_h || _region_col >= _region_w) return;
+    if (_region_col == 0) setCursor(_region_x, _region_y + _region_row);
+    while (_region_col < _region_w) {
+      writeChar(' ');
+      _region_col++;
+    }
+  }
+
+  /// Collects the bytes of a UTF-8 sequence and replaces the value with the
+  /// display character: returns false while the sequence is not complete.
+  /// Invalid bytes and single bytes outside of a string are passed on
+  /// unchanged and incomplete sequences are dropped.
+  bool decodeUTF8(uint8_t &value) {
+    if (_utf8_pending > 0 && (value & 0xC0) == 0x80) {
+      _utf8_lead = 0;
+      _utf8_cp = (_utf8_cp << 6) | (value & 0x3F);
+      if (--_utf8_pending > 0) return false;
+      value = displayChar(_utf8_cp);
+      return true;
+    }
+    _utf8_pending = 0;
+    if (!_utf8_buffer && value >= 0x80) return true;
+    if (value >= 0x80) _utf8_lead = value;
+    if (value >= 0xC2 && value <= 0xDF) {
+      _utf8_cp = value & 0x1F;
+      _utf8_pending = 1;
+    } else if ((value & 0xF0) == 0xE0) {
+      _utf8_cp = value & 0x0F;
+      _utf8_pending = 2;
+    } else if (value >= 0xF0 && value <= 0xF4) {
+      _utf8_cp = value & 0x07;
+      _utf8_pending = 3;
+    } else if (value < 0x80) {
+      value = displayChar(value);
+    }
+    if (_utf8_pending == 0) _utf8_lead = 0;
+    return _utf8_pending == 0;
+  }
+
+  /// Sends the lead byte of a sequence which was not continued unchanged
+  void writeLead() {
+    uint8_t lead = _utf8_lead;
+    _utf8_lead = 0;
+    _utf8_pending = 0;
+    writeCell(lead);
+  }
+
+  /// Output of a display character at the cursor or in the region
+  void writeCell(uint8_t value) {
+    if (_region_open && !_addr_cgram) {
+      writeRegion(value);
+    } else {
+      writeChar(value);
+    }
+  }
+
+  /// Determines the display character for a code point: from the ROM, from
+  /// the CGRAM or '?'
+  uint8_t displayChar(uint32_t code_point) {
+    int rom = lcdRomChar(code_point, _rom_code);
+    if (rom >= 0) return rom;
+    int glyph = lcdGlyphIndex(code_point);
+    if (glyph < 0 || _glyph_slots == 0) return '?';
+    for (int j = 0; j < _glyph_slots; j++) {
+      if (_glyph_cp[j] == code_point) return _glyph_first + j;
+    }
+    // load the glyph into the next slot (round robin)
+    uint8_t slot = _glyph_next;
+    _glyph_next = (_glyph_next + 1) % _glyph_slots;
+    _glyph_cp[slot] = code_point;
+    uint8_t bitmap[8];
+    for (int j = 0; j < 8; j++) {
+      bitmap[j] = pgm_read_byte(&lcd_glyphs[glyph].bitmap[j]);
+    }
+    uint8_t addr = _addr;
+    createChar(_glyph_first + slot, bitmap);
+    // continue at the DDRAM position
+    if (!_deferred) {
+      command(LCD_SETDDRAMADDR | addr);
+    }
+    return _glyph_first + slot;
+  }
+};
+
+#ifndef LCD_CLIENT_MAX_DISPLAYS
+#define LCD_CLIENT_MAX_DISPLAYS 16
+#endif
+
+/**
+ * @brief LCDClient which processes the request provided by the indicated Stream
+ * in the Arduino loop call process(). The pin commands (e.g. from a LCD with
+ * a LCDWriteDriver) are executed directly. Commands from a LCDRemote are
+ * dispatched to the display which was registered with the display id of the
+ * command, so that multiple displays can share the same stream.
+ */
+class LCDClient {
+ public:
+  LCDClient(Stream &in) { p_in = &in; };
+
+  /// Registers the display for the indicated id (0-15)
+  bool addDisplay(uint8_t id, CommonLCD &lcd) {
+    if (id >= LCD_CLIENT_MAX_DISPLAYS) return false;
+    p_displays[id] = &lcd;
+    return true;
+  }
+
+  /// Call this method in the loop
+  void process(int delay_no_data = 100) {
+    if (p_in->available() > 0) {
+      if (p_in->readBytes((uint8_t *)&cmd, sizeof(Cmd)) > 0) {
+        CommonLCD *target = cmd.display() < LCD_CLIENT_MAX_DISPLAYS
+                                ? p_displays[cmd.display()]
+                                : nullptr;
+        switch (cmd.command()) {
+          case MODE:
+            pinMode(cmd.p1, cmd.p2);
+            break;
+          case WRITE:
+            digitalWrite(cmd.p1, cmd.p2);
+            break;
+          case DELAY:
+            delayMicroseconds(cmd.p1);
+            break;
+          case PULSE:
+            // p2 is 0 for senders which do not provide the settle time
+            defaultDriver.pulseEnable(cmd.p1,
+                                      cmd.p2 > 0 ? cmd.p2 : LCD_TIMING_COMMAND_US);
+            break;
+          case BRIGHTNESS:
+            // commands with a pin (e.g. from a LCDWriteDriver) drive the pin
+            if (cmd.p1 != LCD_REMOTE_PIN) {
+              defaultDriver.setBrightness(cmd.p1, cmd.p2);
+            } else if (target == nullptr) {
+              Serial.print("Error - undefined display");
+            } else {
+              target->setBrightness(cmd.p2);
+            }
+            break;
+          case SEND:
+            if (target == nullptr) {
+              Serial.print("Error - undefined display");
+            } else if (cmd.p2 == LOW) {
+              target->command(cmd.p1);
+            } else {
+              target->writeData(cmd.p1);
+            }
+            break;
+          case BEGIN:
+            if (target == nullptr) {
+              Serial.print("Error - undefined display");
+            } else {
+              target->begin(cmd.p1, cmd.p2);
+            }
+            break;
+          default:
+            Serial.print("Error - undefined id");
+            break;
+        }
+      }
+    } else {
+      delay(delay_no_data);
+    }
+  }
+
+ protected:
+  Stream *p_in = nullptr;
+  static const int len = 80;
+  Cmd cmd;
+  LCDDriver defaultDriver;
+  CommonLCD *p_displays[LCD_CLIENT_MAX_DISPLAYS] = {};
+};
+
+/**
+ * @brief Display which is driven remotely by a LCDClient: the command and
+ * data bytes are sent over the indicated Print (e.g. Serial) together with
+ * the display id which was used in LCDClient::addDisplay()
+ */
+class LCDRemote : public CommonLCD {
+ public:
+  LCDRemote(Print &out, uint8_t display_id = 0) : _writer(out) {
+    _display_id = display_id;
+  }
+
+  void begin(uint8_t cols, uint8_t lines, uint8_t dotsize = LCD_5x8DOTS) {
+    _numlines = lines;
+    _cols = cols;
+    setRowOffsets(0x00, 0x40, 0x00 + cols, 0x40 + cols);
+    _displaycontrol = LCD_DISPLAYON | LCD_CURSOROFF | LCD_BLINKOFF;
+    _displaymode = LCD_ENTRYLEFT | LCD_ENTRYSHIFTDECREMENT;
+    _writer.write(Cmd(BEGIN, cols, lines, _display_id));
+    trackCommand(LCD_CLEARDISPLAY);
+    _writer.flush();
+  }
+
+  /// Sends the buffered commands
+  void flush() override { _writer.flush(); }
+
+  /// Number of writes to the output
+  uint32_t packets() { return _writer.packets(); }
+
+ protected:
+  LCDWriteDriver _writer;
+  uint8_t _display_id;
+
+  void writeBrightness(uint16_t percent) override {
+    _writer.write(Cmd(BRIGHTNESS, LCD_REMOTE_PIN, percent, _display_id));
+    _writer.flush();
+  }
+
+  bool isRemote() override { return true; }
+
+  size_t writeLabel(const LCDLabelRef &label) override {
+    if (!isLabelDirect()) return CommonLCD::writeLabel(label);
+    LCD_STATS_TIME(LCD_OP_PRINT);
+    LCD_STATS_ADD(data, label.len);
+    _writer.write(label.packet, label.len, _display_id);
+    for (int j = 0; j < label.len; j++) {
+      trackData(pgm_read_byte(label.text + j));
+    }
+    _writer.flush();
+    return label.len;
+  }
+
+  void send(uint8_t value, uint8_t mode) override {
+    _writer.write(Cmd(SEND, value, mode, _display_id));
+  }
+
+  void delayMicrosecondsLCD(uint16_t ms) override {
+    LCD_STATS_ADD(delay_us, ms);
+    _writer.write(Cmd(DELAY, ms, 0, _display_id));
+  }
+};
+
+/**
+ * @brief Output to LCD
+ *
+ */
+class LCD : public CommonLCD {
+ public:
+  // When the display powers up, it is configured as follows:
+  //
+  // 1. Display clear
+  // 2. Function set:
+  //    DL = 1; 8-bit interface data
+  //    N = 0; 1-line display
+  //    F = 0; 5x8 dot character font
+  // 3. Display on/off control:
+  //    D = 0; Display off
+  //    C = 0; Cursor off
   //    B = 0; Blinking off
   // 4. Entry mode set:
   //    I/D = 1; Increment by 1
@@ -362,24 +1814,32 @@ class LCD : public CommonLCD {
 
   LCD(uint8_t rs, uint8_t rw, uint8_t enable, uint8_t d0, uint8_t d1,
       uint8_t d2, uint8_t d3, uint8_t d4, uint8_t d5, uint8_t d6, uint8_t d7,
-      uint8_t leda = 0, AbstractLCDDriver &driver = defaultDriver) {
+      uint8_t leda = 0, AbstractLCDDriver &driver = defaultDriver,
+      const LCDTiming &timing = LCDTiming()) {
+    _timing = timing;
     init(0, rs, rw, enable, d0, d1, d2, d3, d4, d5, d6, d7, leda, driver);
   }
 
   LCD(uint8_t rs, uint8_t enable, uint8_t d0, uint8_t d1, uint8_t d2,
       uint8_t d3, uint8_t d4, uint8_t d5, uint8_t d6, uint8_t d7,
-      uint8_t leda = 0, AbstractLCDDriver &driver = defaultDriver) {
+      uint8_t leda = 0, AbstractLCDDriver &driver = defaultDriver,
+      const LCDTiming &timing = LCDTiming()) {
+    _timing = timing;
     init(0, rs, 255, enable, d0, d1, d2, d3, d4, d5, d6, d7, leda, driver);
   }
 
   LCD(uint8_t rs, uint8_t rw, uint8_t enable, uint8_t d0, uint8_t d1,
       uint8_t d2, uint8_t d3, uint8_t leda = 0,
-      AbstractLCDDriver &driver = defaultDriver) {
+      AbstractLCDDriver &driver = defaultDriver,
+      const LCDTiming &timing = LCDTiming()) {
+    _timing = timing;
     init(1, rs, rw, enable, d0, d1, d2, d3, 0, 0, 0, 0, leda, driver);
   }
 
   LCD(uint8_t rs, uint8_t enable, uint8_t d0, uint8_t d1, uint8_t d2,
-      uint8_t d3, uint8_t leda = 0, AbstractLCDDriver &driver = defaultDriver) {
+      uint8_t d3, uint8_t leda = 0, AbstractLCDDriver &driver = defaultDriver,
+      const LCDTiming &timing = LCDTiming()) {
+    _timing = timing;
     init(1, rs, 255, enable, d0, d1, d2, d3, 0, 0, 0, 0, leda, driver);
   }
 
@@ -388,12 +1848,24 @@ class LCD : public CommonLCD {
       _displayfunction |= LCD_2LINE;
     }
     _numlines = lines;
+    _cols = cols;
 
     if (_led_a != 0) {
       pinModeLCD(_led_a, OUTPUT);
     }
 
-    setRowOffsets(0x00, 0x40, 0x00 + cols, 0x40 + cols);
+    if (_enable_pin2 != 255) {
+      // each controller drives 2 rows
+      setRowOffsets(0x00, 0x40, 0x00, 0x40);
+      pinModeLCD(_enable_pin2, OUTPUT);
+      digitalWriteLCD(_enable_pin2, LOW);
+    } else {
+      setRowOffsets(0x00, 0x40, 0x00 + cols, 0x40 + cols);
+    }
+    // the initialization is sent to all controllers
+    _controller = 0;
+    _target = 3;
+    _broadcast = true;
 
     // for some 1 line displays you can select a 10 pixel high font
     if ((dotsize != LCD_5x8DOTS) && (lines == 1)) {
@@ -418,7 +1890,7 @@ class LCD : public CommonLCD {
     // according to datasheet, we need at least 40 ms after power rises
     // above 2.7 V before sending commands. Arduino can turn on way before 4.5 V
     // so we'll wait 50
-    delayMicrosecondsLCD(50000);
+    delayLongLCD(_timing.power_on_us);
     // Now we pull both RS and R/W low to begin commands
     digitalWriteLCD(_rs_pin, LOW);
     digitalWriteLCD(_enable_pin, LOW);
@@ -433,15 +1905,15 @@ class LCD : public CommonLCD {
 
       // we start in 8bit mode, try to set 4 bit mode
       write4bits(0x03);
-      delayMicrosecondsLCD(4500);  // wait min 4.1ms
+      delayMicrosecondsLCD(_timing.init_us);  // wait min 4.1ms
 
       // second try
       write4bits(0x03);
-      delayMicrosecondsLCD(4500);  // wait min 4.1ms
+      delayMicrosecondsLCD(_timing.init_us);  // wait min 4.1ms
 
       // third go!
       write4bits(0x03);
-      delayMicrosecondsLCD(150);
+      delayMicrosecondsLCD(_timing.init_short_us);
 
       // finally, set to 4-bit interface
       write4bits(0x02);
@@ -451,11 +1923,11 @@ class LCD : public CommonLCD {
 
       // Send function set command sequence
       command(LCD_FUNCTIONSET | _displayfunction);
-      delayMicrosecondsLCD(4500);  // wait more than 4.1 ms
+      delayMicrosecondsLCD(_timing.init_us);  // wait more than 4.1 ms
 
       // second try
       command(LCD_FUNCTIONSET | _displayfunction);
-      delayMicrosecondsLCD(150);
+      delayMicrosecondsLCD(_timing.init_short_us);
 
       // third go
       command(LCD_FUNCTIONSET | _displayfunction);
@@ -475,15 +1947,37 @@ class LCD : public CommonLCD {
     _displaymode = LCD_ENTRYLEFT | LCD_ENTRYSHIFTDECREMENT;
     // set the entry mode
     command(LCD_ENTRYMODESET | _displaymode);
+    _broadcast = false;
+    _other_addr = 0;
+    _other_cgram = false;
   }
 
-  /// Defines the brightness (0-100)
-  void setBrightness(uint16_t percent) override {
-    if (_led_a != 0) {
-      p_driver->setBrightness(_led_a, percent);
-    }
+  /// Reads the character at the indicated DDRAM address: the RW pin is
+  /// needed (-1 if not available)
+  int readDDRAM(uint8_t addr) override {
+    return readRAM(LCD_SETDDRAMADDR | (addr & 0x7F));
+  }
+
+  /// Reads the byte at the indicated CGRAM address: the RW pin is needed
+  /// (-1 if not available)
+  int readCGRAM(uint8_t addr) override {
+    return readRAM(LCD_SETCGRAMADDR | (addr & 0x3F));
   }
 
+  /// 40x4 displays consist of 2 controllers with separate enable pins: rows
+  /// 0-1 are displayed by the first and rows 2-3 by the second controller.
+  /// Commands which are not related to the address (e.g. clear) are sent to
+  /// both controllers at the same time. The shadow (and deferred output) is
+  /// not supported for this configuration. Call before begin().
+  void setSecondController(uint8_t enable2) { _enable_pin2 = enable2; }
+
+  /// Both controllers use the same addresses, so they can not share the
+  /// shadow
+  bool isShadowSupported() override { return _enable_pin2 == 255; }
+
+  /// Sends the commands which were buffered by the driver
+  void flush() override { p_driver->flush(); }
+
   // /// Obsolete
   // void printstr(const char c[]) {
   //   // This function is not identical to the function used for "real" I2C
@@ -492,6 +1986,15 @@ class LCD : public CommonLCD {
   // }
 
  protected:
+  void writeBrightness(uint16_t percent) override {
+    if (_led_a != 0) {
+      p_driver->setBrightness(_led_a, percent);
+      if (_batch == 0) flush();
+    }
+  }
+
+  bool isRemote() override { return !p_driver->isLocal(); }
+
   void init(uint8_t fourbitmode, uint8_t rs, uint8_t rw, uint8_t enable,
             uint8_t d0, uint8_t d1, uint8_t d2, uint8_t d3, uint8_t d4,
             uint8_t d5, uint8_t d6, uint8_t d7, uint8_t led_a,
@@ -519,222 +2022,1843 @@ class LCD : public CommonLCD {
 
     begin(16, 1);
   }
-  // write either command or data, with automatic 4/8-bit selection
-  void send(uint8_t value, uint8_t mode) {
-    digitalWriteLCD(_rs_pin, mode);
+  // write either command or data, with automatic 4/8-bit selection
+  void send(uint8_t value, uint8_t mode) {
+    if (_enable_pin2 != 255 && !_broadcast) {
+      _target = controllers(value, mode);
+      uint8_t active = _controller == 0 ? 1 : 2;
+      // the cursor is only displayed by the active controller
+      if (_target == 3 && mode == LOW &&
+          (value & 0xF8) == LCD_DISPLAYCONTROL &&
+          (value & (LCD_CURSORON | LCD_BLINKON))) {
+        _target = active;
+        transfer(value, mode);
+        _target = 3 - active;
+        transfer(value & ~(LCD_CURSORON | LCD_BLINKON), mode);
+        return;
+      }
+      if (_target == 3) trackOther(value, mode);
+    }
+    transfer(value, mode);
+  }
+
+  /// Determines the controllers (bit 0 = first, bit 1 = second) which
+  /// need to receive the command or data
+  uint8_t controllers(uint8_t value, uint8_t mode) {
+    uint8_t active = _controller == 0 ? 1 : 2;
+    if (mode == HIGH) {
+      // custom characters are needed by both controllers
+      return _cgram_write ? 3 : active;
+    }
+    if (value & LCD_SETDDRAMADDR) {
+      _cgram_write = false;
+      return active;
+    }
+    if (value & LCD_SETCGRAMADDR) {
+      _cgram_write = true;
+    } else if (value < LCD_ENTRYMODESET) {
+      // clear or home
+      _cgram_write = false;
+    }
+    return 3;
+  }
+
+  /// Keeps track of the address counter of the inactive controller
+  void trackOther(uint8_t value, uint8_t mode) {
+    bool left = _displaymode & LCD_ENTRYLEFT;
+    if (mode == HIGH) {
+      _other_addr = _other_cgram ? (_other_addr + (left ? 1 : -1)) & 0x3F
+                                 : nextAddress(_other_addr, left);
+    } else if (value & LCD_SETCGRAMADDR) {
+      _other_addr = value & 0x3F;
+      _other_cgram = true;
+    } else if ((value & 0xF0) == LCD_CURSORSHIFT) {
+      // moveCursorLeft/Right() is sent to both controllers
+      if (!(value & LCD_DISPLAYMOVE)) {
+        _other_addr = nextAddress(_other_addr, value & LCD_MOVERIGHT);
+      }
+    } else if (value < LCD_ENTRYMODESET) {
+      _other_addr = 0;
+      _other_cgram = false;
+    }
+  }
+
+  /// Switches the controller which receives the data
+  void selectRow(uint8_t row) override {
+    uint8_t controller = row >= 2 ? 1 : 0;
+    if (_enable_pin2 == 255 || controller == _controller) return;
+    _controller = controller;
+    // swap the address tracking
+    uint8_t addr = _hw_addr;
+    bool cgram = _hw_cgram;
+    _hw_addr = _other_addr;
+    _hw_cgram = _other_cgram;
+    _other_addr = addr;
+    _other_cgram = cgram;
+    if (!_deferred) {
+      _addr = _hw_addr;
+      _addr_cgram = _hw_cgram;
+    }
+    if (_displaycontrol & (LCD_CURSORON | LCD_BLINKON)) {
+      command(LCD_DISPLAYCONTROL | _displaycontrol);
+    }
+  }
+
+  void transfer(uint8_t value, uint8_t mode) {
+    digitalWriteLCD(_rs_pin, mode);
+
+    // if there is a RW pin indicated, set it low to Write
+    if (_rw_pin != 255) {
+      digitalWriteLCD(_rw_pin, LOW);
+    }
+
+    if (_displayfunction & LCD_8BITMODE) {
+      write8bits(value);
+    } else {
+      write4bits(value >> 4);
+      write4bits(value);
+    }
+  }
+
+  void pulseEnable(void) {
+    if (_enable_pin2 == 255) {
+      LCD_STATS_ADD(gpio_writes, 3);  // enable LOW, HIGH, LOW
+      p_driver->pulseEnable(_enable_pin, _timing.command_us);
+      return;
+    }
+    // pulse the controllers back to back: the execution times overlap
+    if (_target & 1) {
+      LCD_STATS_ADD(gpio_writes, 3);
+      p_driver->pulseEnable(_enable_pin, _target & 2 ? 0 : _timing.command_us);
+    }
+    if (_target & 2) {
+      LCD_STATS_ADD(gpio_writes, 3);
+      p_driver->pulseEnable(_enable_pin2, _timing.command_us);
+    }
+  }
+
+  void write4bits(uint8_t value) {
+    for (int i = 0; i < 4; i++) {
+      digitalWriteLCD(_data_pins[i], (value >> i) & 0x01);
+    }
+
+    pulseEnable();
+  }
+
+  void write8bits(uint8_t value) {
+    for (int i = 0; i < 8; i++) {
+      digitalWriteLCD(_data_pins[i], (value >> i) & 0x01);
+    }
+    pulseEnable();
+  }
+
+  /// Sets the address and reads the data: the cursor position is restored
+  int readRAM(uint8_t address_cmd) {
+    // remote drivers can not read
+    if (_rw_pin == 255 || _enable_pin2 != 255 || !p_driver->isLocal()) {
+      return -1;
+    }
+    uint8_t addr = _addr;
+    bool addr_cgram = _addr_cgram;
+    beginBatch();
+    command(address_cmd);
+    uint8_t result = readData();
+    if (!_deferred) {
+      command(addr_cgram ? LCD_SETCGRAMADDR | addr : LCD_SETDDRAMADDR | addr);
+    }
+    endBatch();
+    return result;
+  }
+
+  /// Reads the data at the address counter
+  uint8_t readData() {
+    int bits = (_displayfunction & LCD_8BITMODE) ? 8 : 4;
+    for (int i = 0; i < bits; i++) {
+      pinModeLCD(_data_pins[i], INPUT);
+    }
+    digitalWriteLCD(_rs_pin, HIGH);
+    digitalWriteLCD(_rw_pin, HIGH);
+    uint8_t value;
+    if (bits == 8) {
+      value = readBits(8);
+    } else {
+      value = readBits(4) << 4;
+      value |= readBits(4);
+    }
+    digitalWriteLCD(_rw_pin, LOW);
+    for (int i = 0; i < bits; i++) {
+      pinModeLCD(_data_pins[i], OUTPUT);
+    }
+    advanceAddress();
+    return value;
+  }
+
+  /// The data is valid while enable is high
+  uint8_t readBits(int bits) {
+    digitalWriteLCD(_enable_pin, HIGH);
+    delayMicrosecondsLCD(_timing.enable_pulse_us);
+    uint8_t value = 0;
+    for (int i = 0; i < bits; i++) {
+      if (p_driver->digitalReadLCD(_data_pins[i])) value |= 1 << i;
+    }
+    digitalWriteLCD(_enable_pin, LOW);
+    delayMicrosecondsLCD(_timing.command_us);
+    return value;
+  }
+
+  void pinModeLCD(uint16_t pin, uint16_t mode) {
+    p_driver->pinModeLCD(pin, mode);
+  }
+
+  void digitalWriteLCD(uint16_t pin, uint16_t value) {
+    LCD_STATS_ADD(gpio_writes, 1);
+    p_driver->digitalWriteLCD(pin, value);
+  }
+
+  void delayMicrosecondsLCD(uint16_t ms) override {
+    LCD_STATS_ADD(delay_us, ms);
+    p_driver->delayMicrosecondsLCD(ms);
+  }
+
+  // variables
+  uint8_t _rs_pin;      // LOW: command.  HIGH: character.
+  uint8_t _rw_pin;      // LOW: write to LCD.  HIGH: read from LCD.
+  uint8_t _enable_pin;  // activated by a HIGH pulse.
+  uint8_t _data_pins[8];
+  // second controller of 40x4 displays
+  uint8_t _enable_pin2 = 255;
+  uint8_t _controller = 0;
+  uint8_t _target = 1;
+  bool _broadcast = false;
+  bool _cgram_write = false;
+  uint8_t _other_addr = 0;
+  bool _other_cgram = false;
+
+  uint8_t _displayfunction;
+  uint8_t _initialized;
+
+  AbstractLCDDriver *p_driver = nullptr;
+};
+
+/**
+ * @brief Control LCD Display using I2C module. The Wire object nees to be set up
+ * separately.
+ */
+class LCD_I2C : public CommonLCD {
+ public:
+  LCD_I2C(uint8_t lcd_addr, uint8_t led_a = 0,
+          const LCDTiming &timing = LCDTiming()) {
+    _i2c_addr = lcd_addr;
+    _backlightval = LCD_BACKLIGHT;
+    _led_a = led_a;
+    _p_wire = &Wire;
+    _timing = timing;
+  }
+
+  void setWire(TwoWire &wire){
+    _p_wire = &wire;
+  }
+
+  /// Records all expander output and delays to the indicated trace
+  void setTrace(LCDTraceDriver &trace) { _p_trace = &trace; }
+
+  /// Activates the automatic recovery after I2C errors: the display content
+  /// is restored from the shadow, which is enabled by this method
+  bool setAutoRecover(bool active) {
+    _auto_recover = active;
+    return active ? enableShadow() : true;
+  }
+
+  /// Resynchronizes the 4 bit interface and restores the display content
+  /// from the shadow (if enabled). Returns false if I2C errors occurred.
+  bool recover() {
+    uint32_t errors = _errors;
+    _recovering = true;
+    _recoveries++;
+    beginBatch();
+    // 8 bit function set: completes a pending nibble and returns to 8 bit
+    write4bits(0x03 << 4);
+    delayMicrosecondsLCD(_timing.clear_us);
+    write4bits(0x03 << 4);
+    delayMicrosecondsLCD(_timing.init_short_us);
+    write4bits(0x03 << 4);
+    delayMicrosecondsLCD(_timing.init_short_us);
+    write4bits(0x02 << 4);
+    command(LCD_FUNCTIONSET | _displayfunction);
+    if (_shadow != nullptr) {
+      restore();
+    } else {
+      command(LCD_DISPLAYCONTROL | _displaycontrol);
+      command(LCD_ENTRYMODESET | _displaymode);
+      command(_addr_cgram ? LCD_SETCGRAMADDR | _addr
+                          : LCD_SETDDRAMADDR | _addr);
+    }
+    endBatch();
+    _recovering = false;
+    _error = _errors != errors;
+    return !_error;
+  }
+
+  /// Defines the time between automatic recovery attempts while the bus
+  /// keeps failing (default 1000 ms)
+  void setRecoverInterval(uint32_t ms) { _recover_interval_ms = ms; }
+
+  /// Number of failed I2C transmissions
+  uint32_t errors() { return _errors; }
+
+  /// Number of executed recoveries
+  uint32_t recoveries() { return _recoveries; }
+
+  /// Returns true if an I2C error was detected which was not recovered
+  bool hasError() { return _error; }
+
+  /// Activates the I2C clock calibration in begin(): the fastest clock
+  /// rate up to max_hz which passes a test pattern is used for the
+  /// transactions of this display. After each operation the bus is set back
+  /// to bus_hz for the other devices.
+  void setClockCalibration(bool active, uint32_t bus_hz = 100000,
+                           uint32_t max_hz = 1000000) {
+    _calibrate = active;
+    _bus_clock = bus_hz;
+    _max_clock = max_hz;
+  }
+
+  /// Defines the I2C clock rate for this display (0 = do not change the
+  /// clock)
+  void setClock(uint32_t hz, uint32_t bus_hz = 100000) {
+    _clock = hz;
+    _bus_clock = bus_hz;
+  }
+
+  /// I2C clock rate which is used for this display (0 = bus rate)
+  uint32_t clock() { return _clock; }
+
+  /// Determines the fastest clock rate at which the expander acknowledges
+  /// and reads back a test pattern. The enable bit stays low and the
+  /// backlight bit is kept, so the display is not affected. Returns the selected rate (0 if no rate was reliable).
+  uint32_t calibrateClock() {
+    static const uint32_t rates[] = {100000, 200000, 400000, 800000,
+                                     1000000};
+    static const uint8_t patterns[] = {0x00, 0xF0, 0xA0, 0x50, 0xFB, 0x0B};
+    _clock = 0;
+    for (uint32_t rate : rates) {
+      if (rate > _max_clock) break;
+      _p_wire->setClock(rate);
+      bool ok = true;
+      for (uint8_t pattern : patterns) {
+        uint8_t value = (pattern & ~(En | LCD_BACKLIGHT)) | _backlightval;
+        _p_wire->beginTransmission(_i2c_addr);
+        _p_wire->write(value);
+        if (_p_wire->endTransmission() != 0 ||
+            _p_wire->requestFrom(_i2c_addr, (uint8_t)1) != 1 ||
+            _p_wire->read() != value) {
+          ok = false;
+          break;
+        }
+      }
+      if (!ok) break;
+      _clock = rate;
+    }
+    _p_wire->setClock(_bus_clock);
+    _clock_active = false;
+    expanderWrite(0);
+    return _clock;
+  }
+
+  /// Expander bytes per I2C transaction for labels (the Wire buffer is 32
+  /// bytes on most platforms)
+  void setLabelChunkSize(uint8_t bytes) { _label_chunk = bytes; }
+
+  /// Called at the end of each operation: executes the automatic recovery
+  /// and restores the bus clock
+  void flush() override {
+    if (_error && _auto_recover && !_recovering && isRecoveryDue()) {
+      _recover_failed = !recover();
+      _recover_ms = millis();
+    }
+    if (_clock_active) {
+      _p_wire->setClock(_bus_clock);
+      _clock_active = false;
+    }
+  }
+
+  void begin(uint8_t lcd_cols, uint8_t lcd_rows,
+             uint8_t charsize, TwoWire &wire) {
+      setWire(wire);
+      begin(lcd_cols, lcd_rows, charsize);
+  }
+
+  void begin(uint8_t lcd_cols, uint8_t lcd_rows,
+             uint8_t charsize = LCD_5x8DOTS) {
+    _cols = lcd_cols;
+    _rows = lcd_rows;
+    _charsize = charsize;
+    if(_p_wire==nullptr){
+      _p_wire = &Wire;
+    }
+
+    _displayfunction = LCD_4BITMODE | LCD_1LINE | LCD_5x8DOTS;
+
+    if (_rows > 1) {
+      _displayfunction |= LCD_2LINE;
+    }
+    // setCursor() clamps the row with _numlines and needs the row offsets
+    // of this geometry (rows 2 and 3 continue rows 0 and 1 after _cols)
+    _numlines = _rows;
+    setRowOffsets(0x00, 0x40, 0x00 + _cols, 0x40 + _cols);
+
+    // for some 1 line displays you can select a 10 pixel high font
+    if ((_charsize != 0) && (_rows == 1)) {
+      _displayfunction |= LCD_5x10DOTS;
+    }
+
+    // SEE PAGE 45/46 FOR INITIALIZATION SPECIFICATION!
+    // according to datasheet, we need at least 40ms after power rises
+    // above 2.7V before sending commands. Arduino can turn on way befer 4.5V so
+    // we'll wait 50
+    delayLongLCD(_timing.power_on_us);
+
+    // the clock of this display is restored only once at the end
+    beginBatch();
+
+    // Now we pull both RS and R/W low to begin commands
+    expanderWrite(_backlightval);  // reset expanderand turn backlight off (Bit 8 =1)
+    delay(_timing.reset_ms);
+
+    if (_calibrate) {
+      calibrateClock();
+    }
+
+    // put the LCD into 4 bit mode
+    //  this is according to the hitachi HD44780 datasheet
+    //  figure 24, pg 46
+
+    // we start in 8bit mode, try to set 4 bit mode
+    write4bits(0x03 << 4);
+    delayMicrosecondsLCD(_timing.init_us);  // wait min 4.1ms
+
+    // second try
+    write4bits(0x03 << 4);
+    delayMicrosecondsLCD(_timing.init_us);  // wait min 4.1ms
+
+    // third go!
+    write4bits(0x03 << 4);
+    delayMicrosecondsLCD(_timing.init_short_us);
+
+    // finally, set to 4-bit interface
+    write4bits(0x02 << 4);
+
+    // set # lines, font size, etc.
+    command(LCD_FUNCTIONSET | _displayfunction);
+
+    // turn the display on with no cursor or blinking default
+    _displaycontrol = LCD_DISPLAYON | LCD_CURSOROFF | LCD_BLINKOFF;
+    display();
+
+    // clear it off
+    clear();
+
+    // Initialize to default text direction (for roman languages)
+    _displaymode = LCD_ENTRYLEFT | LCD_ENTRYSHIFTDECREMENT;
+
+    // set the entry mode
+    command(LCD_ENTRYMODESET | _displaymode);
+
+    home();
+    endBatch();
+  }
+
+  // Turn the (optional) backlight off/on
+  void noBacklight(void) {
+    _backlightval = LCD_NOBACKLIGHT;
+    beginBatch();
+    expanderWrite(0);
+    endBatch();
+  }
+
+  void backlight(void) {
+    _backlightval = LCD_BACKLIGHT;
+    beginBatch();
+    expanderWrite(0);
+    endBatch();
+  }
+  bool getBacklight() { return _backlightval == LCD_BACKLIGHT; }
+
+ protected:
+  uint8_t _i2c_addr;
+  uint8_t _displayfunction;
+  uint8_t _rows;
+  uint8_t _charsize;
+  uint8_t _backlightval;
+  TwoWire *_p_wire=nullptr;
+  LCDTraceDriver *_p_trace = nullptr;
+  uint32_t _errors = 0;
+  uint32_t _recoveries = 0;
+  bool _error = false;
+  bool _auto_recover = false;
+  bool _recovering = false;
+  bool _recover_failed = false;
+  uint32_t _recover_ms = 0;
+  uint32_t _recover_interval_ms = 1000;
+
+  /// The first recovery is executed immediately. After a failed recovery
+  /// we wait for the interval and only retry if the expander acknowledges.
+  bool isRecoveryDue() {
+    if (!_recover_failed) return true;
+    if (millis() - _recover_ms < _recover_interval_ms) return false;
+    _recover_ms = millis();
+    _p_wire->beginTransmission(_i2c_addr);
+    return _p_wire->endTransmission() == 0;
+  }
+  uint8_t _label_chunk = 32;
+  bool _calibrate = false;
+  bool _clock_active = false;
+  uint32_t _clock = 0;
+  uint32_t _bus_clock = 100000;
+  uint32_t _max_clock = 1000000;
+
+  /// Switches to the clock rate of this display until the next flush()
+  void useClock() {
+    if (_clock != 0 && !_clock_active) {
+      _p_wire->setClock(_clock);
+      _clock_active = true;
+    }
+  }
+
+  const uint8_t LCD_BACKLIGHT = 0x08;
+  const uint8_t LCD_NOBACKLIGHT = 0x00;
+  const uint8_t En = B00000100;  // Enable bit
+  const uint8_t Rw = B00000010;  // Read/Write bit
+  const uint8_t Rs = B00000001;  // Register select bit
+
+  void send(uint8_t value, uint8_t mode) {
+    uint8_t highnib = value & 0xf0;
+    uint8_t lownib = (value << 4) & 0xf0;
+    write4bits((highnib) | mode);
+    write4bits((lownib) | mode);
+  }
+
+  void write4bits(uint8_t value) {
+    expanderWrite(value);
+    pulseEnable(value);
+  }
+
+  void expanderWrite(uint8_t _data) {
+    LCD_STATS_ADD(i2c_transactions, 1);
+    if (_p_trace != nullptr) {
+      _p_trace->record(Cmd(EXPANDER, _i2c_addr, _data | _backlightval));
+    }
+    useClock();
+    _p_wire->beginTransmission(_i2c_addr);
+    _p_wire->write((int)(_data) | _backlightval);
+    // 0 = success, otherwise NACK or bus error
+    if (_p_wire->endTransmission() != 0) {
+      _errors++;
+      _error = true;
+    }
+  }
+
+  void pulseEnable(uint8_t _data) {
+    expanderWrite(_data | En);  // En high
+    delayMicrosecondsLCD(_timing.enable_pulse_us);  // enable pulse must be >450ns
+
+    expanderWrite(_data & ~En);  // En low
+    delayMicrosecondsLCD(_timing.command_us);  // commands need > 37us to settle
+  }
+
+  void load_custom_character(uint8_t char_num, uint8_t *rows) {
+    createChar(char_num, rows);
+  }
+
+  void setBacklight(bool new_val) {
+    if (new_val) {
+      backlight();  // turn backlight on
+    } else {
+      noBacklight();  // turn backlight off
+    }
+  }
+
+  void delayMicrosecondsLCD(uint16_t ms) override {
+    LCD_STATS_ADD(delay_us, ms);
+    if (_p_trace != nullptr) {
+      _p_trace->record(Cmd(DELAY, ms));
+    }
+    delayMicroseconds(ms);
+  }
+
+  /// Sends the pre-encoded expander bytes with a few I2C transactions. The
+  /// execution time of a character is covered by the 3 bytes between two
+  /// latches at slow bus clocks; otherwise each character is sent in its
+  /// own transaction followed by the command delay.
+  size_t writeLabel(const LCDLabelRef &label) override {
+    if (!isLabelDirect() || _p_trace != nullptr) {
+      return CommonLCD::writeLabel(label);
+    }
+    LCD_STATS_TIME(LCD_OP_PRINT);
+    LCD_STATS_ADD(data, label.len);
+    uint32_t hz = _clock != 0 ? _clock : _bus_clock;
+    bool paced = 27000000ul / hz < _timing.command_us;
+    int chunk = paced ? 6 : _label_chunk - _label_chunk % 6;
+    if (chunk < 6) chunk = 6;
+    int total = label.len * 6;
+    int pos = 0;
+    useClock();
+    while (pos < total) {
+      int n = total - pos < chunk ? total - pos : chunk;
+      LCD_STATS_ADD(i2c_transactions, 1);
+      _p_wire->beginTransmission(_i2c_addr);
+      for (int j = 0; j < n; j++) {
+        _p_wire->write(pgm_read_byte(label.i2c + pos + j) | _backlightval);
+      }
+      if (_p_wire->endTransmission() != 0) {
+        _errors++;
+        _error = true;
+      }
+      if (paced) delayMicrosecondsLCD(_timing.command_us);
+      pos += n;
+    }
+    for (int j = 0; j < label.len; j++) {
+      trackData(pgm_read_byte(label.text + j));
+    }
+    flush();
+    return label.len;
+  }
+};
+
+/**
+ * @brief Simple model of a HD44780 controller: it keeps the DDRAM, CGRAM
+ * and the registers up to date from the values which are latched on the
+ * falling edge of the enable signal. The data bus value is provided as
+ * 8 bits: in 4 bit mode only D4-D7 (bits 4-7) are used.
+ */
+class LCDControllerModel : public Printable {
+ public:
+  LCDControllerModel(uint8_t cols = 16, uint8_t rows = 2) {
+    _cols = cols;
+    _rows = rows;
+    reset();
+  }
+
+  /// Power on state: 8 bit interface, empty display
+  void reset() {
+    memset(_ddram, ' ', sizeof(_ddram));
+    memset(_cgram, 0, sizeof(_cgram));
+    _ac = 0;
+    _shift = 0;
+    _is_cgram = false;
+    _is_8bit = true;
+    _has_nibble = false;
+    _entrymode = 0x02;
+    _displaycontrol = 0;
+    _function = 0x10;
+    _time_us = 0;
+  }
+
+  /// Processes the value on the data bus on the falling edge of enable
+  void latch(bool rs, uint8_t bus) {
+    if (_is_8bit) {
+      execute(rs, bus);
+    } else if (!_has_nibble) {
+      _nibble = bus & 0xF0;
+      _has_nibble = true;
+    } else {
+      _has_nibble = false;
+      execute(rs, _nibble | (bus >> 4));
+    }
+  }
+
+  /// Executes an instruction (rs = false) or writes data (rs = true)
+  void execute(bool rs, uint8_t value) {
+    _time_us += 37;
+    if (rs) {
+      writeData(value);
+    } else if (value & 0x80) {
+      _ac = value & 0x7F;
+      _is_cgram = false;
+    } else if (value & 0x40) {
+      _ac = value & 0x3F;
+      _is_cgram = true;
+    } else if (value & 0x20) {
+      _function = value;
+      _is_8bit = value & 0x10;
+      _has_nibble = false;
+    } else if (value & 0x10) {
+      if (value & 0x08) {
+        // R/L = 1 shifts the display to the right
+        shiftDisplay(!(value & 0x04));
+      } else {
+        moveAddress(value & 0x04);
+      }
+    } else if (value & 0x08) {
+      _displaycontrol = value & 0x07;
+    } else if (value & 0x04) {
+      _entrymode = value & 0x03;
+    } else if (value & 0x02) {
+      _ac = 0;
+      _shift = 0;
+      _is_cgram = false;
+      _time_us += 1520 - 37;
+    } else if (value & 0x01) {
+      memset(_ddram, ' ', sizeof(_ddram));
+      _ac = 0;
+      _shift = 0;
+      _is_cgram = false;
+      _entrymode |= 0x02;
+      _time_us += 1520 - 37;
+    }
+  }
+
+  /// Provides the value on the data bus for a read on the rising edge of
+  /// enable: in 4 bit mode the high nibble is provided first (bits 4-7)
+  uint8_t readBus(bool rs) {
+    if (_is_8bit) return read(rs);
+    if (!_has_nibble) {
+      _nibble = read(rs);
+      _has_nibble = true;
+      return _nibble & 0xF0;
+    }
+    _has_nibble = false;
+    return (_nibble << 4) & 0xF0;
+  }
+
+  /// Reads the data (rs = true) at the address counter, which is advanced,
+  /// or the busy flag and address counter (rs = false)
+  uint8_t read(bool rs) {
+    if (!rs) return _ac;  // never busy
+    uint8_t result = _is_cgram ? _cgram[_ac & 0x3F] : _ddram[index(_ac)];
+    moveAddress(_entrymode & 0x02);
+    return result;
+  }
+
+  /// Changes the DDRAM without the controller (e.g. to simulate a glitch)
+  void setDDRAM(uint8_t addr, uint8_t value) { _ddram[index(addr)] = value; }
+
+  /// Character at the indicated DDRAM address
+  uint8_t ddram(uint8_t addr) { return _ddram[index(addr)]; }
+
+  /// Byte at the indicated CGRAM address
+  uint8_t cgram(uint8_t addr) { return _cgram[addr & 0x3F]; }
+
+  /// Actual address counter
+  uint8_t addressCounter() { return _ac; }
+
+  /// Character which is visible at the indicated position
+  uint8_t charAt(uint8_t col, uint8_t row) {
+    // rows 2 and 3 continue rows 0 and 1
+    uint8_t line = row & 0x01;
+    // a shift to the left (positive) shows the next DDRAM address
+    int pos = col + (row >= 2 ? _cols : 0) + _shift;
+    pos = pos % 40;
+    return _ddram[line * 40 + pos];
+  }
+
+  bool isDisplayOn() { return _displaycontrol & 0x04; }
+
+  /// Execution time of the controller in us
+  uint32_t executionTimeUs() { return _time_us; }
+
+  /// Prints the visible screen: one line per row
+  size_t printTo(Print &p) const override {
+    LCDControllerModel &self = (LCDControllerModel &)*this;
+    size_t result = 0;
+    for (int row = 0; row < _rows; row++) {
+      for (int col = 0; col < _cols; col++) {
+        result += p.write(self.charAt(col, row));
+      }
+      result += p.println();
+    }
+    return result;
+  }
+
+ protected:
+  uint8_t _ddram[80];
+  uint8_t _cgram[64];
+  uint8_t _cols;
+  uint8_t _rows;
+  uint8_t _ac;
+  uint8_t _shift;
+  bool _is_cgram;
+  bool _is_8bit;
+  bool _has_nibble;
+  uint8_t _nibble = 0;
+  uint8_t _entrymode;
+  uint8_t _displaycontrol;
+  uint8_t _function;
+  uint32_t _time_us;
+
+  // DDRAM addresses 0x00-0x27 and 0x40-0x67 are mapped to 0-79
+  int index(uint8_t addr) {
+    addr &= 0x7F;
+    return addr >= 0x40 ? 40 + (addr - 0x40) % 40 : addr % 40;
+  }
+
+  void writeData(uint8_t value) {
+    if (_is_cgram) {
+      _cgram[_ac & 0x3F] = value;
+    } else {
+      _ddram[index(_ac)] = value;
+      if (_entrymode & 0x01) {
+        // autoscroll: the display moves against the cursor direction
+        shiftDisplay(_entrymode & 0x02);
+      }
+    }
+    moveAddress(_entrymode & 0x02);
+  }
+
+  /// Shifts the display by one position: after a shift to the left the
+  /// next DDRAM address is displayed in the first column
+  void shiftDisplay(bool left) { _shift = (_shift + (left ? 1 : 39)) % 40; }
+
+  void moveAddress(bool increment) {
+    if (_is_cgram) {
+      _ac = (_ac + (increment ? 1 : -1)) & 0x3F;
+      return;
+    }
+    int pos = index(_ac) + (increment ? 1 : -1);
+    if (pos < 0) pos = 79;
+    if (pos > 79) pos = 0;
+    _ac = pos >= 40 ? 0x40 + pos - 40 : pos;
+  }
+};
+
+/**
+ * @brief Replays a trace which was recorded with LCDTraceDriver into a
+ * LCDControllerModel, so that the final screen, the number of bytes and the
+ * modeled time can be compared without any hardware. For parallel displays
+ * the pins need to be defined with setPins().
+ */
+class LCDTraceReplay {
+ public:
+  LCDTraceReplay(LCDControllerModel &model) { p_model = &model; }
+
+  /// Defines the pins of a parallel display: provide 4 or 8 data pins
+  void setPins(uint16_t rs, uint16_t enable, const uint16_t *data_pins,
+               int data_pin_count) {
+    _rs_pin = rs;
+    _enable_pin = enable;
+    _data_pin_count = data_pin_count > 8 ? 8 : data_pin_count;
+    for (int j = 0; j < _data_pin_count; j++) {
+      _data_pins[j] = data_pins[j];
+    }
+  }
+
+  /// Defines the I2C clock used to model the duration of EXPANDER records
+  void setI2CClock(uint32_t hz) { _i2c_clock = hz; }
+
+  /// Defines the modeled duration of a single pin operation
+  void setPinOperationUs(uint16_t us) { _pin_us = us; }
+
+  /// Processes all available records of the stream
+  size_t replay(Stream &in) {
+    size_t result = 0;
+    LCDTraceRecord rec;
+    while (in.readBytes((uint8_t *)&rec, sizeof(rec)) == sizeof(rec)) {
+      replay(rec);
+      result++;
+    }
+    return result;
+  }
+
+  /// Processes a single record
+  void replay(const LCDTraceRecord &rec) {
+    _recorded_us += rec.delta_us;
+    const Cmd &cmd = rec.cmd;
+    switch (cmd.command()) {
+      case MODE:
+        _bytes += sizeof(Cmd);
+        _modeled_us += _pin_us;
+        break;
+      case WRITE:
+        _bytes += sizeof(Cmd);
+        _modeled_us += _pin_us;
+        setPin(cmd.p1, cmd.p2);
+        break;
+      case PULSE:
+        // LCDDriver: LOW, HIGH, LOW followed by the settle time in p2
+        _bytes += sizeof(Cmd);
+        _modeled_us += 3 * _pin_us + 2 +
+                       (cmd.p2 > 0 ? cmd.p2 : LCD_TIMING_COMMAND_US);
+        if (cmd.p1 == _enable_pin) {
+          p_model->latch(_rs, _bus);
+        }
+        break;
+      case DELAY:
+        _bytes += sizeof(Cmd);
+        _modeled_us += cmd.p1;
+        break;
+      case BRIGHTNESS:
+        _bytes += sizeof(Cmd);
+        _modeled_us += _pin_us;
+        break;
+      case EXPANDER:
+        // address + data byte: start, 2 * 9 bits, stop
+        _bytes += 2;
+        _modeled_us += 20000000ul / _i2c_clock;
+        expander(cmd.p2);
+        break;
+      default:
+        break;
+    }
+  }
+
+  /// Number of bytes which were needed on the bus
+  uint32_t bytes() { return _bytes; }
+
+  /// Modeled time in us
+  uint32_t modeledTimeUs() { return _modeled_us; }
+
+  /// Time in us which passed during the recording
+  uint32_t recordedTimeUs() { return _recorded_us; }
+
+ protected:
+  LCDControllerModel *p_model = nullptr;
+  uint16_t _rs_pin = 0xFFFF;
+  uint16_t _enable_pin = 0xFFFF;
+  uint16_t _data_pins[8];
+  int _data_pin_count = 0;
+  bool _rs = false;
+  bool _enable = false;
+  uint8_t _bus = 0;
+  uint8_t _expander = 0;
+  uint32_t _i2c_clock = 100000;
+  uint16_t _pin_us = 4;
+  uint32_t _bytes = 0;
+  uint32_t _modeled_us = 0;
+  uint32_t _recorded_us = 0;
+
+  void setPin(uint16_t pin, uint16_t value) {
+    if (pin == _rs_pin) {
+      _rs = value;
+    } else if (pin == _enable_pin) {
+      if (_enable && !value) {
+        p_model->latch(_rs, _bus);
+      }
+      _enable = value;
+    } else {
+      // in 4 bit mode the data pins are D4-D7
+      int first_bit = _data_pin_count == 4 ? 4 : 0;
+      for (int j = 0; j < _data_pin_count; j++) {
+        if (_data_pins[j] == pin) {
+          uint8_t bit = 1 << (first_bit + j);
+          _bus = value ? _bus | bit : _bus & ~bit;
+        }
+      }
+    }
+  }
+
+  // PCF8574: P0 = RS, P1 = RW, P2 = EN, P3 = backlight, P4-P7 = D4-D7
+  void expander(uint8_t value) {
+    bool enable_was_high = _expander & 0x04;
+    if (enable_was_high && !(value & 0x04)) {
+      p_model->latch(value & 0x01, value & 0xF0);
+    }
+    _expander = value;
+  }
+};
+
+/**
+ * @brief Driver which emulates a parallel display with a LCDControllerModel
+ * (e.g. to test on Linux): the data is latched on the falling edge of
+ * enable and reads (RW high) are served from the model. The pins need to be
+ * defined with setPins().
+ */
+class LCDEmulatorDriver : public AbstractLCDDriver {
+ public:
+  LCDEmulatorDriver(LCDControllerModel &model) { p_model = &model; }
+
+  /// Defines the pins: provide 4 or 8 data pins
+  void setPins(uint16_t rs, uint16_t rw, uint16_t enable,
+               const uint16_t *data_pins, int n) {
+    _rs = rs;
+    _rw = rw;
+    _enable = enable;
+    _n = n > 8 ? 8 : n;
+    for (int j = 0; j < _n; j++) _data_pins[j] = data_pins[j];
+  }
+
+  void pinModeLCD(uint16_t pin, uint16_t mode) override {}
+
+  void digitalWriteLCD(uint16_t pin, uint16_t value) override {
+    if (pin == _enable) {
+      if (value && !_en && _rw_level) {
+        _read_bus = p_model->readBus(_rs_level);
+      } else if (!value && _en && !_rw_level) {
+        p_model->latch(_rs_level, _bus);
+      }
+      _en = value;
+    } else if (pin == _rs) {
+      _rs_level = value;
+    } else if (pin == _rw) {
+      _rw_level = value;
+    } else {
+      for (int j = 0; j < _n; j++) {
+        if (_data_pins[j] == pin) {
+          uint8_t bit = 1 << (j + 8 - _n);
+          _bus = value ? (_bus | bit) : (_bus & ~bit);
+        }
+      }
+    }
+  }
+
+  uint16_t digitalReadLCD(uint16_t pin) override {
+    for (int j = 0; j < _n; j++) {
+      if (_data_pins[j] == pin) return (_read_bus >> (j + 8 - _n)) & 1;
+    }
+    return LOW;
+  }
+
+  void delayMicrosecondsLCD(uint16_t us) override { _delay_us += us; }
+
+  using AbstractLCDDriver::pulseEnable;
+  void pulseEnable(uint16_t pin, uint16_t settle_us) override {
+    digitalWriteLCD(pin, HIGH);
+    digitalWriteLCD(pin, LOW);
+    _delay_us += settle_us;
+  }
+
+  void setBrightness(uint16_t pin, uint16_t percent) override {
+    _brightness = percent;
+  }
+
+  /// Last brightness in percent
+  uint16_t brightness() { return _brightness; }
+
+  /// Sum of all requested delays in us (the emulator does not wait)
+  uint32_t delayUs() { return _delay_us; }
+
+ protected:
+  LCDControllerModel *p_model = nullptr;
+  uint16_t _rs = 0;
+  uint16_t _rw = 255;
+  uint16_t _enable = 0;
+  uint16_t _data_pins[8];
+  int _n = 0;
+  bool _rs_level = false;
+  bool _rw_level = false;
+  bool _en = false;
+  uint8_t _bus = 0;
+  uint8_t _read_bus = 0;
+  uint16_t _brightness = 0;
+  uint32_t _delay_us = 0;
+};
+
+/**
+ * @brief Scrolls a long text in one row. On displays with up to 2 rows the
+ * text is loaded into the invisible part of the DDRAM (40 characters per
+ * row) and scrolled with the one byte display shift command: only the
+ * character which becomes visible needs to be sent if the text is longer
+ * then the DDRAM. The display shift moves all rows, so the rows which must
+ * not scroll (setStaticText()) are rewritten where they changed. On displays
+ * with more rows the text is scrolled in software. Call tick() in the loop.
+ */
+class LCDMarquee {
+ public:
+  LCDMarquee(CommonLCD &lcd, uint8_t row = 0, uint16_t interval_ms = 300) {
+    p_lcd = &lcd;
+    _row = row;
+    _interval = interval_ms;
+  }
+
+  /// Defines the scrolling text (which is not copied): after the end we
+  /// continue with the indicated number of spaces
+  void setText(const char *text, uint8_t gap = 4) {
+    _text = text;
+    _len = strlen(text);
+    _period = _len + gap;
+    if (_active) begin();
+  }
+
+  /// Defines the text (which is not copied) of a row which does not scroll
+  void setStaticText(uint8_t row, const char *text) {
+    if (row >= 4) return;
+    _static[row] = text;
+    _static_len[row] = text != nullptr ? strlen(text) : 0;
+    if (_active) begin();
+  }
+
+  /// Displays the text from the beginning
+  void begin() {
+    if (_text == nullptr) return;
+    _active = true;
+    _pos = 0;
+    _window = 0;
+    _last = millis();
+    uint8_t cols = p_lcd->cols();
+    _hardware = p_lcd->rows() <= 2 && cols < DDRAM_LINE;
+    if (_hardware) {
+      // reset the display shift and fill the whole DDRAM line
+      p_lcd->home();
+      p_lcd->setCursor(0, _row);
+      for (int j = 0; j < DDRAM_LINE; j++) {
+        p_lcd->write(textAt(j));
+      }
+      for (int row = 0; row < p_lcd->rows(); row++) {
+        if (row == _row || _static[row] == nullptr) continue;
+        p_lcd->setCursor(0, row);
+        for (int j = 0; j < cols; j++) {
+          p_lcd->write(staticAt(row, j));
+        }
+      }
+    } else {
+      p_lcd->setCursor(0, _row);
+      for (int j = 0; j < cols; j++) {
+        p_lcd->write(textAt(j));
+      }
+    }
+  }
+
+  /// Stops the scrolling and resets the display shift
+  void end() {
+    if (_active && _hardware) {
+      p_lcd->home();
+    }
+    _active = false;
+  }
+
+  /// Call this method in the loop: scrolls when the interval has passed
+  bool tick() {
+    if (!_active || millis() - _last < _interval) return false;
+    _last = millis();
+    step();
+    return true;
+  }
+
+  /// Scrolls by one character
+  void step() {
+    if (!_active) return;
+    uint8_t cols = p_lcd->cols();
+    if (_hardware) {
+      // prepare the cell which becomes visible: it contains the character
+      // from one DDRAM line length before
+      uint8_t col = (_window + cols) % DDRAM_LINE;
+      uint8_t value = textAt(_pos + cols);
+      if (value != textAt(_pos + cols + (uint32_t)_period * DDRAM_LINE -
+                          DDRAM_LINE)) {
+        p_lcd->setCursor(col, _row);
+        p_lcd->write(value);
+      }
+      p_lcd->scrollDisplayLeft();
+      _window = (_window + 1) % DDRAM_LINE;
+      _pos = (_pos + 1) % _period;
+
+      // move the static rows back: cell j shows what was in cell j + 1
+      for (int row = 0; row < p_lcd->rows(); row++) {
+        if (row == _row || _static[row] == nullptr) continue;
+        int next_col = -1;
+        for (int j = 0; j < cols; j++) {
+          uint8_t value = staticAt(row, j);
+          if (j + 1 < cols && value == staticAt(row, j + 1)) continue;
+          int col = (_window + j) % DDRAM_LINE;
+          if (col != next_col) {
+            p_lcd->setCursor(col, row);
+          }
+          p_lcd->write(value);
+          next_col = col + 1;
+        }
+      }
+    } else {
+      // software: write the characters which have changed
+      uint16_t prior = _pos;
+      _pos = (_pos + 1) % _period;
+      int next_col = -1;
+      for (int j = 0; j < cols; j++) {
+        uint8_t value = textAt(_pos + j);
+        if (value == textAt(prior + j)) continue;
+        if (j != next_col) {
+          p_lcd->setCursor(j, _row);
+        }
+        p_lcd->write(value);
+        next_col = j + 1;
+      }
+    }
+  }
+
+  bool isActive() { return _active; }
+
+ protected:
+  static const int DDRAM_LINE = 40;
+  CommonLCD *p_lcd = nullptr;
+  const char *_text = nullptr;
+  const char *_static[4] = {};
+  uint16_t _static_len[4] = {};
+  uint16_t _len = 0;
+  uint16_t _period = 1;
+  uint16_t _pos = 0;
+  uint16_t _interval;
+  uint32_t _last = 0;
+  uint8_t _row;
+  uint8_t _window = 0;
+  bool _hardware = false;
+  bool _active = false;
+
+  uint8_t textAt(uint32_t idx) {
+    idx %= _period;
+    return idx < _len ? _text[idx] : ' ';
+  }
+
+  uint8_t staticAt(uint8_t row, int idx) {
+    return idx < _static_len[row] ? _static[row][idx] : ' ';
+  }
+};
+
+#ifndef LCD_FIELD_MAX_WIDTH
+#define LCD_FIELD_MAX_WIDTH 20
+#endif
+
+/**
+ * @brief Numeric (or text) field at a fixed position: the value is formatted
+ * without heap or dtostrf into the field width (right aligned by default)
+ * and only the characters which differ from the last output are sent.
+ * Values which do not fit are displayed as '#'.
+ */
+class LCDField {
+ public:
+  /// Empty field (e.g. in arrays): assign a configured field before use
+  LCDField() = default;
+
+  LCDField(CommonLCD &lcd, uint8_t col, uint8_t row, uint8_t width,
+           uint8_t decimals = 0, bool right_align = true, char pad = ' ') {
+    p_lcd = &lcd;
+    _col = col;
+    _row = row;
+    _width = width > LCD_FIELD_MAX_WIDTH ? LCD_FIELD_MAX_WIDTH : width;
+    _decimals = decimals;
+    _right_align = right_align;
+    _pad = pad;
+  }
 
-    // if there is a RW pin indicated, set it low to Write
-    if (_rw_pin != 255) {
-      digitalWriteLCD(_rw_pin, LOW);
-    }
+  /// Displays an integer with the number of decimals of the field
+  void print(int value) { print((long)value); }
 
-    if (_displayfunction & LCD_8BITMODE) {
-      write8bits(value);
-    } else {
-      write4bits(value >> 4);
-      write4bits(value);
+  /// Displays an integer with the number of decimals of the field
+  void print(long value) {
+    long limit = LONG_MAX / scale();
+    if (value > limit || value < -limit) {
+      printOverflow();
+      return;
     }
+    printFixed(value * scale(), _decimals);
   }
 
-  void pulseEnable(void) { p_driver->pulseEnable(_enable_pin); }
+  /// Displays an unsigned integer (e.g. from millis())
+  void print(unsigned int value) { print((unsigned long)value); }
 
-  void write4bits(uint8_t value) {
-    for (int i = 0; i < 4; i++) {
-      digitalWriteLCD(_data_pins[i], (value >> i) & 0x01);
+  /// Displays an unsigned integer (e.g. from millis())
+  void print(unsigned long value) {
+    if (value > (unsigned long)(LONG_MAX / scale())) {
+      printOverflow();
+      return;
     }
-
-    pulseEnable();
+    printFixed((long)value * scale(), _decimals);
   }
 
-  void write8bits(uint8_t value) {
-    for (int i = 0; i < 8; i++) {
-      digitalWriteLCD(_data_pins[i], (value >> i) & 0x01);
+  /// Displays a float rounded to the number of decimals of the field
+  void print(double value) {
+    double scaled = value * scale();
+    // also catches NaN
+    if (!(scaled > -(double)LONG_MAX && scaled < (double)LONG_MAX)) {
+      printOverflow();
+      return;
     }
-    pulseEnable();
+    printFixed(scaled < 0 ? (long)(scaled - 0.5) : (long)(scaled + 0.5),
+               _decimals);
   }
 
-  void pinModeLCD(uint16_t pin, uint16_t mode) {
-    p_driver->pinModeLCD(pin, mode);
+  /// Displays a fixed point value: e.g. 235 with 1 decimal is 23.5
+  void printFixed(long value, uint8_t decimals) {
+    char tmp[LCD_FIELD_MAX_WIDTH + 1];
+    int len = 0;
+    bool negative = value < 0;
+    unsigned long rest = negative ? 0ul - (unsigned long)value : value;
+    // digits in reverse order
+    do {
+      if (len == decimals && decimals > 0) tmp[len++] = '.';
+      tmp[len++] = '0' + rest % 10;
+      rest /= 10;
+    } while ((rest > 0 || len <= decimals) && len < LCD_FIELD_MAX_WIDTH);
+    if (negative && len < LCD_FIELD_MAX_WIDTH) tmp[len++] = '-';
+
+    if (rest > 0 || len > _width) {
+      printOverflow();
+      return;
+    }
+    char str[LCD_FIELD_MAX_WIDTH + 1];
+    for (int j = 0; j < len; j++) {
+      str[j] = tmp[len - 1 - j];
+    }
+    str[len] = 0;
+    print(str);
   }
 
-  void digitalWriteLCD(uint16_t pin, uint16_t value) {
-    p_driver->digitalWriteLCD(pin, value);
+  /// Displays a text (which is truncated to the field width)
+  void print(const char *text) {
+    uint8_t str[LCD_FIELD_MAX_WIDTH];
+    int len = strlen(text);
+    if (len > _width) len = _width;
+    int start = _right_align ? _width - len : 0;
+    memset(str, _pad, _width);
+    memcpy(str + start, text, len);
+    render(str);
   }
 
-  void delayMicrosecondsLCD(uint16_t ms) override { p_driver->delayMicrosecondsLCD(ms); }
+  /// The next output will send all characters
+  void invalidate() { _valid = false; }
 
-  // variables
-  uint8_t _rs_pin;      // LOW: command.  HIGH: character.
-  uint8_t _rw_pin;      // LOW: write to LCD.  HIGH: read from LCD.
-  uint8_t _enable_pin;  // activated by a HIGH pulse.
-  uint8_t _data_pins[8];
+  /// Fills the field with the pad character
+  void clear() { print(""); }
 
-  uint8_t _displayfunction;
-  uint8_t _initialized;
+ protected:
+  CommonLCD *p_lcd = nullptr;
+  uint8_t _col = 0;
+  uint8_t _row = 0;
+  uint8_t _width = 0;
+  uint8_t _decimals = 0;
+  bool _right_align = true;
+  char _pad = ' ';
+  bool _valid = false;
+  uint8_t _prior[LCD_FIELD_MAX_WIDTH];
+
+  /// Fills the field with '#' for values which do not fit
+  void printOverflow() {
+    char str[LCD_FIELD_MAX_WIDTH + 1];
+    memset(str, '#', _width);
+    str[_width] = 0;
+    print(str);
+  }
 
-  AbstractLCDDriver *p_driver = nullptr;
+  long scale() {
+    long result = 1;
+    for (int j = 0; j < _decimals; j++) result *= 10;
+    return result;
+  }
+
+  /// Sends the characters which have changed
+  void render(const uint8_t *str) {
+    int next_col = -1;
+    for (int j = 0; j < _width; j++) {
+      bool changed = !_valid || str[j] != _prior[j];
+      // an unchanged char between two changes costs the same as setCursor
+      bool bridge = next_col == j && j + 1 < _width && str[j + 1] != _prior[j + 1];
+      if (!changed && !bridge) continue;
+      if (next_col != j) {
+        p_lcd->setCursor(_col + j, _row);
+      }
+      p_lcd->write(str[j]);
+      _prior[j] = str[j];
+      next_col = j + 1;
+    }
+    _valid = true;
+  }
 };
 
+#ifndef LCD_BIG_NUMBER_MAX_DIGITS
+#define LCD_BIG_NUMBER_MAX_DIGITS 10
+#endif
+
+#ifndef LCD_BIG_NUMBER_MAX_SPACING
+#define LCD_BIG_NUMBER_MAX_SPACING 3
+#endif
+
 /**
- * @brief Control LCD Display using I2C module. The Wire object nees to be set up
- * separately.
+ * @brief Displays numbers with digits which are 3 columns wide and 2 or 4
+ * rows high. The digits are composed of the built in full block (0xFF) and
+ * a few segment glyphs which are uploaded to the CGRAM in begin(): 3 slots
+ * for 2 rows and 2 slots for 4 rows starting at first_slot (default 5, so
+ * that they do not collide with the slots 0-4 of LCDBarGraph). Only the
+ * digits which have changed are redrawn. Values which do not fit (including
+ * the sign) are displayed as '#'.
  */
-class LCD_I2C : public CommonLCD {
+class LCDBigNumber {
  public:
-  LCD_I2C(uint8_t lcd_addr, uint8_t led_a = 0) {
-    _addr = lcd_addr;
-    _backlightval = LCD_BACKLIGHT;
-    _led_a = led_a;
-    _p_wire = &Wire;
+  LCDBigNumber(CommonLCD &lcd, uint8_t col, uint8_t row, uint8_t digits,
+               uint8_t height = 2, uint8_t first_slot = 5,
+               uint8_t spacing = 1) {
+    p_lcd = &lcd;
+    _col = col;
+    _row = row;
+    _digits = digits > LCD_BIG_NUMBER_MAX_DIGITS ? LCD_BIG_NUMBER_MAX_DIGITS
+                                                  : digits;
+    _height = height == 4 ? 4 : 2;
+    _first_slot = first_slot;
+    _spacing = spacing > LCD_BIG_NUMBER_MAX_SPACING
+                   ? LCD_BIG_NUMBER_MAX_SPACING
+                   : spacing;
   }
 
-  void setWire(TwoWire &wire){
-    _p_wire = &wire;
+  /// Number of CGRAM slots which are needed for the indicated height
+  static uint8_t slots(uint8_t height) { return height == 4 ? 2 : 3; }
+
+  /// Uploads the segment glyphs into the CGRAM
+  void begin() {
+    static const uint8_t glyphs[3][8] = {
+        {B11111, B11111, B00000, B00000, B00000, B00000, B00000, B00000},
+        {B00000, B00000, B00000, B00000, B00000, B00000, B11111, B11111},
+        {B11111, B11111, B00000, B00000, B00000, B00000, B11111, B11111}};
+    for (int j = 0; j < slots(_height); j++) {
+      p_lcd->createChar(_first_slot + j, glyphs[j]);
+    }
+    invalidate();
   }
 
-  void begin(uint8_t lcd_cols, uint8_t lcd_rows,
-             uint8_t charsize, TwoWire &wire) {
-      setWire(wire);
-      begin(lcd_cols, lcd_rows, charsize);
+  /// Displays the value right aligned: leading digits stay empty
+  void print(long value) {
+    uint8_t codes[LCD_BIG_NUMBER_MAX_DIGITS];
+    bool negative = value < 0;
+    unsigned long rest = negative ? 0ul - (unsigned long)value : value;
+    for (int j = _digits - 1; j >= 0; j--) {
+      if (rest > 0 || j == _digits - 1) {
+        codes[j] = rest % 10;
+        rest /= 10;
+      } else if (negative) {
+        codes[j] = MINUS;
+        negative = false;
+      } else {
+        codes[j] = BLANK;
+      }
+    }
+    if (rest > 0 || negative) {
+      // the value or its sign does not fit
+      for (int j = 0; j < _digits; j++) codes[j] = OVERFLOW;
+    }
+    render(codes);
   }
 
-  void begin(uint8_t lcd_cols, uint8_t lcd_rows,
-             uint8_t charsize = LCD_5x8DOTS) {
-    _cols = lcd_cols;
-    _rows = lcd_rows;
-    _charsize = charsize;
-    if(_p_wire==nullptr){
-      _p_wire = &Wire;
-    }
+  /// The next print() redraws all digits
+  void invalidate() { _valid = false; }
 
-    _displayfunction = LCD_4BITMODE | LCD_1LINE | LCD_5x8DOTS;
+ protected:
+  static const uint8_t MINUS = 10;
+  static const uint8_t BLANK = 11;
+  static const uint8_t OVERFLOW = 12;
+  CommonLCD *p_lcd = nullptr;
+  uint8_t _col;
+  uint8_t _row;
+  uint8_t _digits;
+  uint8_t _height;
+  uint8_t _first_slot;
+  uint8_t _spacing;
+  bool _valid = false;
+  uint8_t _prior[LCD_BIG_NUMBER_MAX_DIGITS];
+
+  /// Segments of a digit row: T = top bar, B = bottom bar, X = both bars,
+  /// F = full block, # = overflow marker
+  const char *segments(uint8_t code, uint8_t row) {
+    static const char *two_rows[13][2] = {
+        {"FTF", "FBF"}, {"TF ", "BFB"}, {"XXF", "FBB"}, {"XXF", "BBF"},
+        {"FBF", "  F"}, {"FXX", "BBF"}, {"FXX", "FBF"}, {"TTF", "  F"},
+        {"FXF", "FBF"}, {"FXF", "BBF"}, {"BBB", "   "}, {"   ", "   "},
+        {"###", "###"}};
+    static const char *four_rows[13][4] = {
+        {"FTF", "F F", "F F", "FBF"}, {"TF ", " F ", " F ", "BFB"},
+        {"TTF", "BBF", "F  ", "FBB"}, {"TTF", "BBF", "  F", "BBF"},
+        {"F F", "FBF", "  F", "  F"}, {"FTT", "FBB", "  F", "BBF"},
+        {"FTT", "FBB", "F F", "FBF"}, {"TTF", "  F", "  F", "  F"},
+        {"FTF", "FBF", "F F", "FBF"}, {"FTF", "FBF", "  F", "BBF"},
+        {"   ", "BBB", "   ", "   "}, {"   ", "   ", "   ", "   "},
+        {"###", "###", "###", "###"}};
+    return _height == 4 ? four_rows[code][row] : two_rows[code][row];
+  }
 
-    if (_rows > 1) {
-      _displayfunction |= LCD_2LINE;
+  uint8_t glyph(char segment) {
+    switch (segment) {
+      case 'T':
+        return _first_slot;
+      case 'B':
+        return _first_slot + 1;
+      case 'X':
+        return _first_slot + 2;
+      case 'F':
+        return 0xFF;
+      case '#':
+        return '#';
+      default:
+        return ' ';
     }
+  }
 
-    // for some 1 line displays you can select a 10 pixel high font
-    if ((_charsize != 0) && (_rows == 1)) {
-      _displayfunction |= LCD_5x10DOTS;
+  /// Redraws the runs of changed digits: one write per row and run
+  void render(const uint8_t *codes) {
+    const int pitch = 3 + _spacing;
+    uint8_t line[LCD_BIG_NUMBER_MAX_DIGITS * (3 + LCD_BIG_NUMBER_MAX_SPACING)];
+    int j = 0;
+    while (j < _digits) {
+      if (_valid && codes[j] == _prior[j]) {
+        j++;
+        continue;
+      }
+      int end = j;
+      while (end < _digits && (!_valid || codes[end] != _prior[end])) end++;
+      for (int row = 0; row < _height; row++) {
+        int len = 0;
+        for (int d = j; d < end; d++) {
+          const char *seg = segments(codes[d], row);
+          for (int c = 0; c < 3; c++) line[len++] = glyph(seg[c]);
+          // the spacing is only written when it is followed by a digit
+          if (d + 1 < end) {
+            for (int c = 0; c < _spacing; c++) line[len++] = ' ';
+          }
+        }
+        p_lcd->setCursor(_col + j * pitch, _row + row);
+        p_lcd->write(line, len);
+      }
+      for (int d = j; d < end; d++) _prior[d] = codes[d];
+      j = end;
     }
+    _valid = true;
+  }
+};
 
-    // SEE PAGE 45/46 FOR INITIALIZATION SPECIFICATION!
-    // according to datasheet, we need at least 40ms after power rises
-    // above 2.7V before sending commands. Arduino can turn on way befer 4.5V so
-    // we'll wait 50
-    delay(50);
-
-    // Now we pull both RS and R/W low to begin commands
-    expanderWrite(_backlightval);  // reset expanderand turn backlight off (Bit 8 =1)
-    delay(1000);
+#ifndef LCD_CANVAS_MAX_TILES
+#define LCD_CANVAS_MAX_TILES 20
+#endif
 
-    // put the LCD into 4 bit mode
-    //  this is according to the hitachi HD44780 datasheet
-    //  figure 24, pg 46
+/**
+ * @brief Small bitmap canvas which is displayed with custom characters e.g.
+ * for sparklines. Each cell shows a tile of 5x8 pixels: blank tiles are
+ * displayed as space and full tiles as 0xFF, identical tiles share the same
+ * CGRAM slot and only tiles which are not already in the CGRAM are uploaded.
+ * Tiles which do not find a free slot are displayed as space.
+ */
+class LCDCanvas {
+ public:
+  LCDCanvas(CommonLCD &lcd, uint8_t col, uint8_t row, uint8_t tiles_x,
+            uint8_t tiles_y = 1, uint8_t first_slot = 0, uint8_t slots = 8) {
+    p_lcd = &lcd;
+    _col = col;
+    _row = row;
+    if (tiles_x * tiles_y > LCD_CANVAS_MAX_TILES) {
+      tiles_y = 1;
+      if (tiles_x > LCD_CANVAS_MAX_TILES) tiles_x = LCD_CANVAS_MAX_TILES;
+    }
+    _tiles_x = tiles_x;
+    _tiles_y = tiles_y;
+    _first_slot = first_slot;
+    _slots = first_slot + slots > 8 ? 8 - first_slot : slots;
+    clear();
+    invalidate();
+  }
 
-    // we start in 8bit mode, try to set 4 bit mode
-    write4bits(0x03 << 4);
-    delayMicrosecondsLCD(4500);  // wait min 4.1ms
+  /// Width in pixels
+  int width() { return _tiles_x * 5; }
 
-    // second try
-    write4bits(0x03 << 4);
-    delayMicrosecondsLCD(4500);  // wait min 4.1ms
+  /// Height in pixels
+  int height() { return _tiles_y * 8; }
 
-    // third go!
-    write4bits(0x03 << 4);
-    delayMicrosecondsLCD(150);
+  /// Clears all pixels (call show() to display the result)
+  void clear() { memset(_bitmap, 0, sizeof(_bitmap)); }
 
-    // finally, set to 4-bit interface
-    write4bits(0x02 << 4);
+  void setPixel(int x, int y, bool on = true) {
+    if (x < 0 || y < 0 || x >= width() || y >= height()) return;
+    uint8_t &line = _bitmap[lineIndex(x, y)];
+    uint8_t mask = 0x10 >> (x % 5);
+    line = on ? (line | mask) : (line & ~mask);
+  }
 
-    // set # lines, font size, etc.
-    command(LCD_FUNCTIONSET | _displayfunction);
+  bool getPixel(int x, int y) {
+    if (x < 0 || y < 0 || x >= width() || y >= height()) return false;
+    return _bitmap[lineIndex(x, y)] & (0x10 >> (x % 5));
+  }
 
-    // turn the display on with no cursor or blinking default
-    _displaycontrol = LCD_DISPLAYON | LCD_CURSOROFF | LCD_BLINKOFF;
-    display();
+  /// Scrolls the canvas by one pixel to the left and draws the value (0 to
+  /// height()) in the last column: as bar or as single dot
+  void push(int value, bool fill = true) {
+    for (int ty = 0; ty < _tiles_y; ty++) {
+      for (int y = 0; y < 8; y++) {
+        for (int tx = 0; tx < _tiles_x; tx++) {
+          uint8_t &line = _bitmap[(ty * _tiles_x + tx) * 8 + y];
+          uint8_t carry =
+              tx + 1 < _tiles_x ? _bitmap[(ty * _tiles_x + tx + 1) * 8 + y] : 0;
+          line = ((line << 1) & 0x1F) | ((carry >> 4) & 1);
+        }
+      }
+    }
+    int x = width() - 1;
+    for (int y = 0; y < height(); y++) {
+      int level = height() - y;
+      setPixel(x, y, fill ? level <= value : level == value);
+    }
+  }
 
-    // clear it off
-    clear();
+  /// Uploads the changed tiles and updates the changed cells
+  void show() {
+    uint8_t codes[LCD_CANVAS_MAX_TILES];
+    bool used[8] = {false};
+    int count = _tiles_x * _tiles_y;
+
+    // assign the CGRAM slots
+    for (int t = 0; t < count; t++) {
+      const uint8_t *tile = _bitmap + t * 8;
+      if (isUniform(tile, 0)) {
+        codes[t] = ' ';
+      } else if (isUniform(tile, 0x1F)) {
+        codes[t] = 0xFF;
+      } else {
+        int slot = findSlot(tile);
+        if (slot < 0) slot = allocateSlot(used);
+        if (slot < 0) {
+          codes[t] = ' ';
+          continue;
+        }
+        if (!_loaded[slot] || memcmp(_glyphs[slot], tile, 8) != 0) {
+          memcpy(_glyphs[slot], tile, 8);
+          _loaded[slot] = true;
+          p_lcd->createChar(_first_slot + slot, _glyphs[slot]);
+        }
+        used[slot] = true;
+        codes[t] = _first_slot + slot;
+      }
+    }
+    memcpy(_in_use, used, sizeof(_in_use));
+
+    // write the changed cells
+    for (int ty = 0; ty < _tiles_y; ty++) {
+      int tx = 0;
+      while (tx < _tiles_x) {
+        int idx = ty * _tiles_x + tx;
+        if (_valid && codes[idx] == _prior[idx]) {
+          tx++;
+          continue;
+        }
+        int start = tx;
+        while (tx < _tiles_x &&
+               (!_valid || codes[ty * _tiles_x + tx] != _prior[ty * _tiles_x + tx]))
+          tx++;
+        p_lcd->setCursor(_col + start, _row + ty);
+        p_lcd->write(codes + ty * _tiles_x + start, tx - start);
+      }
+    }
+    memcpy(_prior, codes, count);
+    _valid = true;
+  }
 
-    // Initialize to default text direction (for roman languages)
-    _displaymode = LCD_ENTRYLEFT | LCD_ENTRYSHIFTDECREMENT;
+  /// The next show() rewrites all cells and glyphs (e.g. after a clear or
+  /// after some other code has used the CGRAM slots)
+  void invalidate() {
+    _valid = false;
+    memset(_loaded, 0, sizeof(_loaded));
+    memset(_in_use, 0, sizeof(_in_use));
+  }
 
-    // set the entry mode
-    command(LCD_ENTRYMODESET | _displaymode);
+ protected:
+  CommonLCD *p_lcd = nullptr;
+  uint8_t _col;
+  uint8_t _row;
+  uint8_t _tiles_x;
+  uint8_t _tiles_y;
+  uint8_t _first_slot;
+  uint8_t _slots;
+  bool _valid = false;
+  uint8_t _bitmap[LCD_CANVAS_MAX_TILES * 8];
+  uint8_t _prior[LCD_CANVAS_MAX_TILES];
+  uint8_t _glyphs[8][8];
+  bool _loaded[8];
+  // slots which are referenced by the displayed cells
+  bool _in_use[8];
+
+  int lineIndex(int x, int y) {
+    return ((y / 8) * _tiles_x + x / 5) * 8 + y % 8;
+  }
 
-    home();
+  bool isUniform(const uint8_t *tile, uint8_t value) {
+    for (int j = 0; j < 8; j++) {
+      if ((tile[j] & 0x1F) != value) return false;
+    }
+    return true;
   }
 
-  // Turn the (optional) backlight off/on
-  void noBacklight(void) {
-    _backlightval = LCD_NOBACKLIGHT;
-    expanderWrite(0);
+  /// Slot which already contains the tile
+  int findSlot(const uint8_t *tile) {
+    for (int j = 0; j < _slots; j++) {
+      if (_loaded[j] && memcmp(_glyphs[j], tile, 8) == 0) return j;
+    }
+    return -1;
   }
 
-  void backlight(void) {
-    _backlightval = LCD_BACKLIGHT;
-    expanderWrite(0);
+  /// Slot which is not used by this frame: we prefer slots which are not
+  /// visible to avoid flicker
+  int allocateSlot(const bool *used) {
+    for (int j = 0; j < _slots; j++) {
+      if (!used[j] && !_in_use[j]) return j;
+    }
+    for (int j = 0; j < _slots; j++) {
+      if (!used[j]) return j;
+    }
+    return -1;
   }
-  bool getBacklight() { return _backlightval == LCD_BACKLIGHT; }
+};
 
- protected:
-  uint8_t _addr;
-  uint8_t _displaycontrol;
-  uint8_t _displayfunction;
-  uint8_t _displaymode;
-  uint8_t _cols;
-  uint8_t _rows;
-  uint8_t _charsize;
-  uint8_t _backlightval;
-  TwoWire *_p_wire=nullptr;
+#ifndef LCD_ANIMATION_MAX_ICONS
+#define LCD_ANIMATION_MAX_ICONS 4
+#endif
 
-  const uint8_t LCD_BACKLIGHT = 0x08;
-  const uint8_t LCD_NOBACKLIGHT = 0x00;
-  const uint8_t En = B00000100;  // Enable bit
-  const uint8_t Rw = B00000010;  // Read/Write bit
-  const uint8_t Rs = B00000001;  // Register select bit
+/**
+ * @brief Animated icons (e.g. spinner, battery charging): each icon uses 2
+ * CGRAM slots. The next frame is uploaded into the slot which is not visible
+ * and then the cell is switched to this slot with a single write, so that
+ * the visible glyph is never modified. The upload is skipped if the slot
+ * already contains the frame (e.g. for animations with 2 frames). Call
+ * tick() in the loop.
+ */
+class LCDAnimation {
+ public:
+  LCDAnimation(CommonLCD &lcd) { p_lcd = &lcd; }
+
+  /// Adds an icon with the indicated frames (which must stay valid) and
+  /// returns its index or -1 if there is no more space
+  int add(uint8_t col, uint8_t row, const uint8_t (*frames)[8],
+          uint8_t frame_count, uint16_t interval_ms, uint8_t slot_a,
+          uint8_t slot_b) {
+    if (_count >= LCD_ANIMATION_MAX_ICONS || frame_count == 0) return -1;
+    Icon &icon = _icons[_count];
+    icon.col = col;
+    icon.row = row;
+    icon.frames = frames;
+    icon.frame_count = frame_count;
+    icon.interval_ms = interval_ms;
+    icon.slot[0] = slot_a;
+    icon.slot[1] = slot_b;
+    return _count++;
+  }
 
-  void send(uint8_t value, uint8_t mode) {
-    uint8_t highnib = value & 0xf0;
-    uint8_t lownib = (value << 4) & 0xf0;
-    write4bits((highnib) | mode);
-    write4bits((lownib) | mode);
+  /// Displays the first frame of all icons
+  void begin() {
+    for (int j = 0; j < _count; j++) {
+      Icon &icon = _icons[j];
+      icon.loaded[0] = icon.loaded[1] = NONE;
+      icon.frame = icon.frame_count - 1;
+      icon.visible = 1;
+      icon.active = true;
+      show(icon, 0);
+    }
   }
 
-  void write4bits(uint8_t value) {
-    expanderWrite(value);
-    pulseEnable(value);
+  /// Stops or restarts the animation of an icon
+  void setActive(int idx, bool active) {
+    if (idx >= 0 && idx < _count) _icons[idx].active = active;
   }
 
-  void expanderWrite(uint8_t _data) {
-    _p_wire->beginTransmission(_addr);
-    _p_wire->write((int)(_data) | _backlightval);
-    _p_wire->endTransmission();
+  /// Advances the icons which are due: call this method in the loop
+  void tick() {
+    uint32_t now = millis();
+    for (int j = 0; j < _count; j++) {
+      Icon &icon = _icons[j];
+      if (!icon.active || now - icon.last_ms < icon.interval_ms) continue;
+      icon.last_ms = now;
+      show(icon, (icon.frame + 1) % icon.frame_count);
+    }
   }
 
-  void pulseEnable(uint8_t _data) {
-    expanderWrite(_data | En);  // En high
-    delayMicrosecondsLCD(1);       // enable pulse must be >450ns
+  /// Number of icons
+  int size() { return _count; }
 
-    expanderWrite(_data & ~En);  // En low
-    delayMicrosecondsLCD(50);       // commands need > 37us to settle
+ protected:
+  static const uint8_t NONE = 0xFF;
+  struct Icon {
+    uint8_t col;
+    uint8_t row;
+    const uint8_t (*frames)[8] = nullptr;
+    uint8_t frame_count = 0;
+    uint8_t frame = 0;
+    uint16_t interval_ms = 0;
+    uint32_t last_ms = 0;
+    uint8_t slot[2];
+    // frame index which is stored in the slot
+    uint8_t loaded[2] = {NONE, NONE};
+    uint8_t visible = 0;
+    bool active = false;
+  };
+  CommonLCD *p_lcd = nullptr;
+  Icon _icons[LCD_ANIMATION_MAX_ICONS];
+  int _count = 0;
+
+  void show(Icon &icon, uint8_t frame) {
+    uint8_t hidden = 1 - icon.visible;
+    if (icon.loaded[hidden] != frame) {
+      p_lcd->createChar(icon.slot[hidden], icon.frames[frame]);
+      icon.loaded[hidden] = frame;
+    }
+    p_lcd->setCursor(icon.col, icon.row);
+    p_lcd->write(icon.slot[hidden]);
+    icon.visible = hidden;
+    icon.frame = frame;
   }
+};
 
-  void load_custom_character(uint8_t char_num, uint8_t *rows) {
-    createChar(char_num, rows);
+#ifndef LCD_GROUP_MAX_DISPLAYS
+#define LCD_GROUP_MAX_DISPLAYS 8
+#endif
+
+/**
+ * @brief Multiple displays which share the same bus: the displays are put
+ * into deferred mode and update() sends the changed cells round robin
+ * within a common time budget, so that a burst on one display does not
+ * starve the others. Only displays with pending changes get a time slice.
+ */
+class LCDDisplayGroup {
+ public:
+  /// Adds a display (after begin()) and activates its deferred mode
+  bool add(CommonLCD &lcd) {
+    if (_count >= LCD_GROUP_MAX_DISPLAYS) return false;
+    if (!lcd.setDeferred(true)) return false;
+    _displays[_count++] = &lcd;
+    return true;
   }
 
-  void setBacklight(bool new_val) {
-    if (new_val) {
-      backlight();  // turn backlight on
-    } else {
-      noBacklight();  // turn backlight off
+  /// Number of displays
+  int size() { return _count; }
+
+  /// Provides the display at the indicated index
+  CommonLCD &operator[](int idx) { return *_displays[idx]; }
+
+  /// Sends the changed cells of all displays within the indicated time
+  /// in us (0 = no limit). Returns the number of remaining changed cells.
+  size_t update(uint32_t budget_us = 0) {
+    uint32_t start = micros();
+    size_t result = 0;
+    while (true) {
+      int pending = 0;
+      for (int j = 0; j < _count; j++) {
+        if (_displays[j]->backlog() > 0) pending++;
+      }
+      if (pending == 0) return 0;
+
+      uint32_t used = micros() - start;
+      if (budget_us > 0 && used >= budget_us) break;
+
+      // give each display with a backlog the same share of the rest
+      uint32_t slice = budget_us > 0 ? (budget_us - used) / pending : 0;
+      if (budget_us > 0 && slice == 0) slice = 1;
+      for (int n = 0; n < _count; n++) {
+        CommonLCD *lcd = _displays[_next];
+        _next = (_next + 1) % _count;
+        if (lcd->backlog() > 0) {
+          lcd->update(slice);
+        }
+        if (budget_us > 0 && micros() - start >= budget_us) break;
+      }
     }
+    for (int j = 0; j < _count; j++) {
+      result += _displays[j]->backlog();
+    }
+    return result;
+  }
+
+  /// Number of changed cells which still need to be sent to the display
+  size_t backlog(int idx) { return _displays[idx]->backlog(); }
+
+  /// Number of changed cells of all displays
+  size_t backlog() {
+    size_t result = 0;
+    for (int j = 0; j < _count; j++) {
+      result += backlog(j);
+    }
+    return result;
   }
-  
-  void delayMicrosecondsLCD(uint16_t ms) override { delayMicroseconds(ms); }
 
+ protected:
+  CommonLCD *_displays[LCD_GROUP_MAX_DISPLAYS];
+  int _count = 0;
+  int _next = 0;
 };
 
 /**
@@ -1083,4 +4207,140 @@ class LCDMenu {
   LCDMenuScreen *current_screen = nullptr;
   int current = 0;
   bool active = false;
-};
\ No newline at end of file
+};
+
+#ifndef LCD_MENU_LIST_MAX_ROWS
+#define LCD_MENU_LIST_MAX_ROWS 4
+#endif
+
+/**
+ * @brief Menu list over any number of items which are provided on demand by
+ * a callback: only the visible rows are requested and the memory does not
+ * depend on the number of items. The selected item is marked with '>' and
+ * only the rows which show a different item (or marker) are redrawn. The
+ * text of an item is limited to LCD_FIELD_MAX_WIDTH characters.
+ */
+class LCDMenuList {
+ public:
+  LCDMenuList(CommonLCD &lcd, uint16_t count,
+              void (*provider)(uint16_t idx, char *str, int len),
+              uint8_t row = 0, uint8_t rows = 2, uint8_t col = 0,
+              uint8_t width = 16) {
+    p_lcd = &lcd;
+    _count = count;
+    p_provider = provider;
+    _row = row;
+    _rows = rows > LCD_MENU_LIST_MAX_ROWS ? LCD_MENU_LIST_MAX_ROWS : rows;
+    _col = col;
+    _width = width;
+    for (int j = 0; j < _rows; j++) {
+      // the first column is used for the marker
+      _fields[j] = LCDField(lcd, col + 1, row + j, width - 1, 0, false);
+      _row_item[j] = DIRTY;
+      _row_marker[j] = false;
+    }
+  }
+
+  LCDMenuList(const LCDMenuList &) = delete;
+  LCDMenuList &operator=(const LCDMenuList &) = delete;
+
+  /// Defines the callback which is called by select()
+  void setSelect(void (*select)(uint16_t idx)) { p_select = select; }
+
+  /// Updates the number of items (e.g. if a log was extended)
+  void setCount(uint16_t count) {
+    _count = count;
+    if (_pos >= _count) _pos = _count > 0 ? _count - 1 : 0;
+    if (_top + _rows > _count) _top = _count > _rows ? _count - _rows : 0;
+    if (_pos < _top) _top = _pos;
+    refresh();
+  }
+
+  uint16_t count() { return _count; }
+
+  /// Displays the list with the indicated item selected
+  void begin(uint16_t pos = 0) {
+    _active = true;
+    refresh();
+    setPos(pos);
+  }
+
+  /// Deactivates the list
+  void end() { _active = false; }
+
+  /// Redraws all rows (e.g. after the content of the items has changed)
+  void refresh() {
+    for (int j = 0; j < _rows; j++) {
+      _row_item[j] = DIRTY;
+      _fields[j].invalidate();
+    }
+    display();
+  }
+
+  /// Moves to the next item (after the last item we continue with the first)
+  int next() { return setPos(_pos + 1 >= _count ? 0 : _pos + 1); }
+
+  /// Moves to the prior item (before the first item we continue with the
+  /// last)
+  int prior() { return setPos(_pos == 0 ? _count - 1 : _pos - 1); }
+
+  /// Selects the item with the indicated index and scrolls it into view
+  int setPos(uint16_t pos) {
+    if (_count == 0) return -1;
+    _pos = pos >= _count ? _count - 1 : pos;
+    if (_pos < _top) _top = _pos;
+    if (_pos >= _top + _rows) _top = _pos - _rows + 1;
+    display();
+    return _pos;
+  }
+
+  /// Index of the selected item
+  uint16_t pos() { return _pos; }
+
+  /// Executes the callback for the selected item
+  void select() {
+    if (p_select != nullptr && _count > 0) p_select(_pos);
+  }
+
+ protected:
+  static const uint16_t NONE = 0xFFFF;
+  // row content is unknown and must be redrawn
+  static const uint16_t DIRTY = 0xFFFE;
+  CommonLCD *p_lcd = nullptr;
+  LCDField _fields[LCD_MENU_LIST_MAX_ROWS];
+  void (*p_provider)(uint16_t idx, char *str, int len) = nullptr;
+  void (*p_select)(uint16_t idx) = nullptr;
+  uint16_t _count;
+  uint16_t _pos = 0;
+  uint16_t _top = 0;
+  uint8_t _row;
+  uint8_t _rows;
+  uint8_t _col;
+  uint8_t _width;
+  bool _active = false;
+  // item and marker which are displayed in the row
+  uint16_t _row_item[LCD_MENU_LIST_MAX_ROWS];
+  bool _row_marker[LCD_MENU_LIST_MAX_ROWS];
+
+  /// Redraws the rows which show a different item or marker
+  void display() {
+    if (!_active) return;
+    for (int j = 0; j < _rows; j++) {
+      uint16_t item = _top + j < _count ? _top + j : NONE;
+      bool marker = item != NONE && item == _pos;
+      if (_row_item[j] == item && _row_marker[j] == marker) continue;
+      if (_row_item[j] == DIRTY || _row_marker[j] != marker) {
+        p_lcd->setCursor(_col, _row + j);
+        p_lcd->write(marker ? '>' : ' ');
+      }
+      if (_row_item[j] != item) {
+        char str[LCD_FIELD_MAX_WIDTH + 1] = {0};
+        if (item != NONE) p_provider(item, str, LCD_FIELD_MAX_WIDTH);
+        str[LCD_FIELD_MAX_WIDTH] = 0;
+        _fields[j].print(str);
+      }
+      _row_item[j] = item;
+      _row_marker[j] = marker;
+    }
+  }
+};
@@ -0,0 +1,235 @@
+#pragma once
+
+#include <SPI.h>
+
+#include "LCD.h"
+
+#ifndef LCD_SPI_BUFFER_SIZE
+#define LCD_SPI_BUFFER_SIZE 32
+#endif
+
+#ifndef LCD_SPI_MOCK_LOG_SIZE
+#define LCD_SPI_MOCK_LOG_SIZE 32
+#endif
+
+/**
+ * @brief Control LCD Display via a 74HC595 shift register using hardware SPI.
+ * The register outputs are wired like a PCF8574 I2C module: Q0 = RS, Q1 = RW,
+ * Q2 = EN, Q3 = backlight, Q4-Q7 = D4-D7. The latch (RCLK) is driven by
+ * latch_pin. The SPI object needs to be set up separately.
+ *
+ * All bytes of an operation (e.g. a print) are collected and sent in one SPI
+ * transaction. Use LCD_SPI for the Arduino SPIClass or provide your own class
+ * e.g. LCDSPIMock as template parameter.
+ */
+template <class SPIT>
+class LCD_SPIT : public CommonLCD {
+ public:
+  LCD_SPIT(SPIT &spi, uint8_t latch_pin, uint8_t led_a = 0,
+           const LCDTiming &timing = LCDTiming()) {
+    _p_spi = &spi;
+    _latch_pin = latch_pin;
+    _led_a = led_a;
+    _backlightval = LCD_BACKLIGHT;
+    _timing = timing;
+  }
+
+  /// Defines the SPI clock (default 4 MHz)
+  void setClock(uint32_t hz) { _clock = hz; }
+
+  void begin(uint8_t lcd_cols, uint8_t lcd_rows,
+             uint8_t charsize = LCD_5x8DOTS) {
+    _cols = lcd_cols;
+    _rows = lcd_rows;
+    _len = 0;
+    pinMode(_latch_pin, OUTPUT);
+    digitalWrite(_latch_pin, LOW);
+
+    _displayfunction = LCD_4BITMODE | LCD_1LINE | LCD_5x8DOTS;
+    if (_rows > 1) {
+      _displayfunction |= LCD_2LINE;
+    }
+    _numlines = _rows;
+    setRowOffsets(0x00, 0x40, 0x00 + _cols, 0x40 + _cols);
+
+    // for some 1 line displays you can select a 10 pixel high font
+    if ((charsize != 0) && (_rows == 1)) {
+      _displayfunction |= LCD_5x10DOTS;
+    }
+
+    // SEE PAGE 45/46 FOR INITIALIZATION SPECIFICATION!
+    delayLongLCD(_timing.power_on_us);
+    shiftOut(0);
+
+    // we start in 8bit mode, try to set 4 bit mode
+    write4bits(0x03 << 4);
+    delayMicrosecondsLCD(_timing.init_us);  // wait min 4.1ms
+    // second try
+    write4bits(0x03 << 4);
+    delayMicrosecondsLCD(_timing.init_us);  // wait min 4.1ms
+    // third go!
+    write4bits(0x03 << 4);
+    delayMicrosecondsLCD(_timing.init_short_us);
+    // finally, set to 4-bit interface
+    write4bits(0x02 << 4);
+
+    // set # lines, font size, etc.
+    command(LCD_FUNCTIONSET | _displayfunction);
+
+    // turn the display on with no cursor or blinking default
+    _displaycontrol = LCD_DISPLAYON | LCD_CURSOROFF | LCD_BLINKOFF;
+    display();
+
+    // clear it off
+    clear();
+
+    // Initialize to default text direction (for roman languages)
+    _displaymode = LCD_ENTRYLEFT | LCD_ENTRYSHIFTDECREMENT;
+    command(LCD_ENTRYMODESET | _displaymode);
+
+    home();
+  }
+
+  // Turn the (optional) backlight off/on
+  void noBacklight(void) {
+    _backlightval = LCD_NOBACKLIGHT;
+    shiftOut(0);
+  }
+
+  void backlight(void) {
+    _backlightval = LCD_BACKLIGHT;
+    shiftOut(0);
+  }
+
+  bool getBacklight() { return _backlightval == LCD_BACKLIGHT; }
+
+  /// Sends all collected bytes in one SPI transaction
+  void flush() override {
+    if (_len == 0) return;
+    _p_spi->beginTransaction(SPISettings(_clock, MSBFIRST, SPI_MODE0));
+    for (int j = 0; j < _len; j++) {
+      latch(_buffer[j]);
+      // each byte consists of 4 register values: wait after the last one
+      if (j % 4 == 3) {
+        CommonLCD::delayMicrosecondsLCD(_timing.command_us);
+      }
+    }
+    _p_spi->endTransaction();
+    _len = 0;
+  }
+
+  /// Sends the collected bytes before waiting, so that the delay follows
+  /// the command which needs it
+  void delayMicrosecondsLCD(uint16_t us) override {
+    flush();
+    CommonLCD::delayMicrosecondsLCD(us);
+  }
+
+ protected:
+  SPIT *_p_spi = nullptr;
+  uint32_t _clock = 4000000;
+  uint8_t _latch_pin;
+  uint8_t _displayfunction;
+  uint8_t _rows;
+  uint8_t _backlightval;
+  uint8_t _buffer[LCD_SPI_BUFFER_SIZE];
+  int _len = 0;
+
+  const uint8_t LCD_BACKLIGHT = 0x08;
+  const uint8_t LCD_NOBACKLIGHT = 0x00;
+  const uint8_t En = B00000100;  // Enable bit
+  const uint8_t Rs = B00000001;  // Register select bit
+
+  // the 4 register values of a byte are collected in the buffer
+  void send(uint8_t value, uint8_t mode) {
+    if (_len + 4 > LCD_SPI_BUFFER_SIZE) {
+      flush();
+    }
+    uint8_t highnib = (value & 0xf0) | (mode ? Rs : 0) | _backlightval;
+    uint8_t lownib = ((value << 4) & 0xf0) | (mode ? Rs : 0) | _backlightval;
+    _buffer[_len++] = highnib | En;
+    _buffer[_len++] = highnib;
+    _buffer[_len++] = lownib | En;
+    _buffer[_len++] = lownib;
+  }
+
+  // only used by the initialization: sent out immediately
+  void write4bits(uint8_t value) {
+    shiftOut(value | En);
+    delayMicrosecondsLCD(_timing.enable_pulse_us);  // enable pulse >450ns
+    shiftOut(value);
+    delayMicrosecondsLCD(_timing.command_us);  // commands need > 37us
+  }
+
+  void shiftOut(uint8_t value) {
+    _p_spi->beginTransaction(SPISettings(_clock, MSBFIRST, SPI_MODE0));
+    latch(value | _backlightval);
+    _p_spi->endTransaction();
+  }
+
+  // shift the value into the register and move it to the outputs
+  void latch(uint8_t value) {
+    LCD_STATS_ADD(spi_bytes, 1);
+    _p_spi->transfer(value);
+    digitalWrite(_latch_pin, HIGH);
+    digitalWrite(_latch_pin, LOW);
+  }
+};
+
+/// LCD via 74HC595 shift register using the Arduino SPIClass
+typedef LCD_SPIT<SPIClass> LCD_SPI;
+
+/**
+ * @brief SPI replacement which can be used as template parameter of LCD_SPIT
+ * to test without hardware (e.g. on Linux): every transferred byte is
+ * treated as latched register value and optionally passed to a
+ * LCDControllerModel.
+ */
+class LCDSPIMock {
+ public:
+  LCDSPIMock() = default;
+  LCDSPIMock(LCDControllerModel &model) { p_model = &model; }
+
+  void begin() {}
+  void end() {}
+  void beginTransaction(SPISettings) { _transactions++; }
+  void endTransaction() {}
+
+  uint8_t transfer(uint8_t value) {
+    if (_bytes < LCD_SPI_MOCK_LOG_SIZE) _log[_bytes] = value;
+    _bytes++;
+    // falling edge of EN latches the data into the controller
+    if (p_model != nullptr && (_last & 0x04) && !(value & 0x04)) {
+      p_model->latch(value & 0x01, value & 0xF0);
+    }
+    _last = value;
+    return 0;
+  }
+
+  /// Number of transferred bytes
+  uint32_t bytes() { return _bytes; }
+
+  /// Number of SPI transactions
+  uint32_t transactions() { return _transactions; }
+
+  /// Last register value
+  uint8_t value() { return _last; }
+
+  /// Register value with the indicated index since the last reset(): only
+  /// the first LCD_SPI_MOCK_LOG_SIZE values are recorded
+  uint8_t value(int idx) {
+    return idx < LCD_SPI_MOCK_LOG_SIZE ? _log[idx] : 0;
+  }
+
+  void reset() {
+    _bytes = 0;
+    _transactions = 0;
+  }
+
+ protected:
+  LCDControllerModel *p_model = nullptr;
+  uint32_t _bytes = 0;
+  uint32_t _transactions = 0;
+  uint8_t _last = 0;
+  uint8_t _log[LCD_SPI_MOCK_LOG_SIZE];
+};